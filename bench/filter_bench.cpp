@@ -0,0 +1,272 @@
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <algorithm>
+#include <cstdlib>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "include/OrangeKV/FilterPolicy.hpp"
+#include "include/OrangeKV/BloomFilter.hpp"
+#include "include/OrangeKV/BlockedBloomFilter.hpp"
+#include "include/OrangeKV/BinaryFuseFilter.hpp"
+#include "include/OrangeKV/RangeFilter.hpp"
+#include "include/OrangeKV/PartitionedFilter.hpp"
+#include "include/OrangeKV/PrefixFilter.hpp"
+#include "include/OrangeKV/CuckooFilter.hpp"
+
+// Measures the false positive rate, against the theory where there is one, and the build and
+// query speed of every FilterPolicy, also with the filter in an AlignedFilter, then checks the
+// number of probes the Bloom filters derive from bits per key against every other choice.
+// Usage: filter_bench [largest number of keys]
+
+using namespace OrangeKV;
+
+namespace {
+    const int kBitsPerKey[] = {4, 6, 8, 10, 12, 16, 20};
+    const size_t kMisses = 1000000;
+    const size_t kPrefixLength = 13; // "user:" and the high 32 bits of the id, for the prefix filters
+    const std::string kDestPrefix = "bytes before the filter"; // Of an odd length, to move the filter off every alignment
+
+    struct KeySet {
+        std::vector<std::string> keys; // Sorted, the partitioned filter needs them in order
+        std::vector<std::string> hits; // The keys, shuffled
+        std::vector<std::string> misses; // Keys that are not in the set
+    };
+
+    KeySet makeKeySet(size_t n) {
+        std::mt19937_64 rng(n);
+        std::vector<uint64_t> ids(n + kMisses);
+        for (uint64_t& id : ids) {
+            id = rng();
+        }
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+        std::shuffle(ids.begin(), ids.end(), rng);
+        KeySet set;
+        char buf[32];
+        for (size_t i = 0; i < ids.size(); i++) {
+            std::snprintf(buf, sizeof(buf), "user:%016llx", static_cast<unsigned long long>(ids[i]));
+            (i < n ? set.keys : set.misses).emplace_back(buf);
+        }
+        set.hits = set.keys;
+        std::sort(set.keys.begin(), set.keys.end());
+        return set;
+    }
+
+    // (1 - e^(-kn/m))^k
+    double bloomTheory(size_t n, double bits, uint32_t k) {
+        return std::pow(1 - std::exp(-static_cast<double>(k) * n / bits), k);
+    }
+
+    // The load of a line is Poisson, a line of j keys has about jk/16 bits set in each 32 bit word
+    double blockedBloomTheory(size_t n, double bits, uint32_t k) {
+        double lines = bits / (blocked::kLineBytes * 8);
+        double mean = n / lines;
+        double fpr = 0;
+        double p = std::exp(-mean);
+        for (int j = 0; j < 10 * mean + 100; j++) {
+            double bitSet = 1 - std::pow(1 - 1.0 / 32, static_cast<double>(j) * k / blocked::kWords);
+            fpr += p * std::pow(bitSet, k);
+            p *= mean / (j + 1);
+        }
+        return fpr;
+    }
+
+    double nsPerOp(std::chrono::steady_clock::time_point start, size_t ops) {
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ops;
+    }
+
+    struct PolicyCase {
+        std::string name;
+        std::unique_ptr<const FilterPolicy> policy;
+        std::function<double(size_t n, double bits, uint32_t k)> theory; // Empty if there is none
+    };
+
+    std::vector<PolicyCase> policiesFor(int bitsPerKey) {
+        std::vector<PolicyCase> cases;
+        cases.push_back({"Bloom", std::unique_ptr<const FilterPolicy>(NewBloomFilterPolicy(bitsPerKey)), bloomTheory});
+        cases.push_back({"BlockedBloom", std::unique_ptr<const FilterPolicy>(NewBlockedBloomFilterPolicy(bitsPerKey)), blockedBloomTheory});
+        cases.push_back({"Partitioned(Blocked)", std::unique_ptr<const FilterPolicy>(NewPartitionedFilterPolicy(NewBlockedBloomFilterPolicy(bitsPerKey), 4096)), {}});
+        cases.push_back({"Partitioned(Bloom)", std::unique_ptr<const FilterPolicy>(NewPartitionedFilterPolicy(NewBloomFilterPolicy(bitsPerKey), 4096)), {}});
+        // The keys and their prefixes share the bits, without whole keys only the prefixes are indexed
+        cases.push_back({"PrefixBloom(13, keys)", std::unique_ptr<const FilterPolicy>(NewPrefixBloomFilterPolicy(new FixedPrefixExtractor(kPrefixLength), bitsPerKey, true)), {}});
+        cases.push_back({"PrefixBloom(13)", std::unique_ptr<const FilterPolicy>(NewPrefixBloomFilterPolicy(new FixedPrefixExtractor(kPrefixLength), bitsPerKey, false)), {}});
+        return cases;
+    }
+
+    // The policies that take no bits per key
+    std::vector<PolicyCase> fixedPolicies() {
+        std::vector<PolicyCase> cases;
+        cases.push_back({"BinaryFuse8", std::unique_ptr<const FilterPolicy>(NewBinaryFuseFilterPolicy()),
+                         [](size_t, double, uint32_t) { return 1.0 / 256; }});
+        cases.push_back({"Range(suffix 1)", std::unique_ptr<const FilterPolicy>(NewRangeFilterPolicy(1)), {}});
+        cases.push_back({"Range(suffix 2)", std::unique_ptr<const FilterPolicy>(NewRangeFilterPolicy(2)), {}});
+        return cases;
+    }
+
+    void benchPolicy(const std::string& label, const PolicyCase& policyCase, const KeySet& set) {
+        const FilterPolicy& policy = *policyCase.policy;
+        size_t n = set.keys.size();
+        std::string filter;
+        auto start = std::chrono::steady_clock::now();
+        policy.createFilter(set.keys.data(), n, filter);
+        double build = nsPerOp(start, n);
+        // A filter appended to a dest that holds other bytes must be the same filter once cut out
+        std::string prefixed = kDestPrefix;
+        policy.createFilter(set.keys.data(), n, prefixed);
+        bool samePrefixed = prefixed.compare(kDestPrefix.size(), std::string::npos, filter) == 0;
+
+        size_t found = 0;
+        start = std::chrono::steady_clock::now();
+        for (const std::string& key : set.hits) {
+            found += policy.keyMayMatch(key, filter);
+        }
+        double hit = nsPerOp(start, n);
+        size_t falsePositives = 0;
+        start = std::chrono::steady_clock::now();
+        for (const std::string& key : set.misses) {
+            falsePositives += policy.keyMayMatch(key, filter);
+        }
+        double miss = nsPerOp(start, set.misses.size());
+        AlignedFilter aligned(filter); // The misses again, with the filter on cache line boundaries
+        size_t alignedFalsePositives = 0;
+        start = std::chrono::steady_clock::now();
+        for (const std::string& key : set.misses) {
+            alignedFalsePositives += policy.keyMayMatchIn(key, aligned.data());
+        }
+        double alignedMiss = nsPerOp(start, set.misses.size());
+        bool sameAligned = alignedFalsePositives == falsePositives;
+        std::vector<std::string_view> views(set.misses.begin(), set.misses.end());
+        std::vector<bool> mayMatch;
+        start = std::chrono::steady_clock::now();
+        policy.keysMayMatch(views, filter, mayMatch);
+        double batch = nsPerOp(start, views.size());
+
+        FilterTrailer trailer{};
+        size_t bytes;
+        ReadFilterTrailer(filter, trailer, bytes);
+        double bits = filter.size() * 8.0;
+        double fpr = 100.0 * falsePositives / set.misses.size();
+        std::string probes = trailer.probes > 0 ? std::to_string(trailer.probes) : "-";
+        std::printf("%-24s %8zu %6s %7.2f %3s %9.4f", policyCase.name.c_str(), n, label.c_str(), bits / n, probes.c_str(), fpr);
+        if (policyCase.theory) {
+            std::printf(" %9.4f", 100 * policyCase.theory(n, bits, trailer.probes));
+        }
+        else {
+            std::printf(" %9s", "-");
+        }
+        std::printf(" %8.1f %8.1f %8.1f %8.1f %8.1f%s%s%s\n", build, hit, miss, alignedMiss, batch, found == n ? "" : "  FALSE NEGATIVES",
+                    samePrefixed ? "" : "  DIFFERS AFTER A PREFIX", sameAligned ? "" : "  DIFFERS ALIGNED");
+    }
+
+    void benchPolicies(const std::vector<size_t>& sizes) {
+        std::printf("== policies (%zu misses per run, times in ns/key)\n", kMisses);
+        std::printf("%-24s %8s %6s %7s %3s %9s %9s %8s %8s %8s %8s %8s\n",
+                    "policy", "keys", "bpk", "actual", "k", "fpr%", "theory%", "build", "hit", "miss", "aligned", "batch");
+        for (size_t n : sizes) {
+            KeySet set = makeKeySet(n);
+            for (int bitsPerKey : kBitsPerKey) {
+                for (const PolicyCase& policyCase : policiesFor(bitsPerKey)) {
+                    benchPolicy(std::to_string(bitsPerKey), policyCase, set);
+                }
+            }
+            for (const PolicyCase& policyCase : fixedPolicies()) {
+                benchPolicy("-", policyCase, set);
+            }
+            std::printf("\n");
+        }
+    }
+
+    // The false positive rate of every k at a number of bits per key, the filters record k so
+    // the policy reads what the builder is given
+    template<typename Builder>
+    void sweepProbes(const char* name, const FilterPolicy& reader, uint32_t maxProbes, const KeySet& set) {
+        std::printf("== %s probes (%zu keys), fpr%% by k, * marks the k the policy derives\n%4s", name, set.keys.size(), "bpk");
+        for (uint32_t k = 1; k <= maxProbes; k++) {
+            std::printf(" %7u", k);
+        }
+        std::printf("\n");
+        for (int bitsPerKey : kBitsPerKey) {
+            uint32_t derived = static_cast<uint32_t>(std::clamp(static_cast<int>(bitsPerKey * 0.69), 1, static_cast<int>(maxProbes)));
+            std::printf("%4d", bitsPerKey);
+            for (uint32_t k = 1; k <= maxProbes; k++) {
+                Builder builder(bitsPerKey, k);
+                for (const std::string& key : set.keys) {
+                    builder.addKey(key);
+                }
+                std::string filter;
+                builder.finish(filter);
+                size_t falsePositives = 0;
+                for (const std::string& key : set.misses) {
+                    falsePositives += reader.keyMayMatch(key, filter);
+                }
+                std::printf(" %6.3f%c", 100.0 * falsePositives / set.misses.size(), k == derived ? '*' : ' ');
+            }
+            std::printf("\n");
+        }
+        std::printf("\n");
+    }
+
+    // Cuckoo filters are not FilterPolicies, they are sized by a target false positive rate
+    void benchCuckoo(const KeySet& set) {
+        std::printf("== cuckoo filters (%zu keys, times in ns/key)\n", set.keys.size());
+        std::printf("%-16s %9s %5s %7s %9s %8s %8s %8s %8s\n", "filter", "target%", "bits", "actual", "fpr%", "insert", "hit", "miss", "erase");
+        auto run = [&](const char* name, auto filter, double target) {
+            size_t n = set.hits.size();
+            auto start = std::chrono::steady_clock::now();
+            for (const std::string& key : set.hits) {
+                filter.insert(key);
+            }
+            double insert = nsPerOp(start, n);
+            size_t found = 0;
+            start = std::chrono::steady_clock::now();
+            for (const std::string& key : set.hits) {
+                found += filter.mayContain(key);
+            }
+            double hit = nsPerOp(start, n);
+            size_t falsePositives = 0;
+            start = std::chrono::steady_clock::now();
+            for (const std::string& key : set.misses) {
+                falsePositives += filter.mayContain(key);
+            }
+            double miss = nsPerOp(start, set.misses.size());
+            double bits = filter.memoryUsage() * 8.0 / n;
+            uint32_t fingerprintBits = filter.fingerprintBits();
+            start = std::chrono::steady_clock::now();
+            for (const std::string& key : set.hits) {
+                filter.erase(key);
+            }
+            double erase = nsPerOp(start, n);
+            std::printf("%-16s %9.4f %5u %7.2f %9.4f %8.1f %8.1f %8.1f %8.1f%s\n", name, 100 * target, fingerprintBits, bits,
+                        100.0 * falsePositives / set.misses.size(), insert, hit, miss, erase, found == n ? "" : "  FALSE NEGATIVES");
+        };
+        run("CuckooFilter8", CuckooFilter8(set.hits.size(), 0.03), 0.03);
+        for (double target : {0.01, 0.001, 0.0001}) {
+            run("CuckooFilter16", CuckooFilter16(set.hits.size(), target), target);
+        }
+        std::printf("\n");
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t maxKeys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    std::vector<size_t> sizes;
+    for (size_t n = 10000; n <= maxKeys; n *= 10) {
+        sizes.push_back(n);
+    }
+    if (sizes.empty()) {
+        sizes.push_back(maxKeys);
+    }
+    benchPolicies(sizes);
+    KeySet largest = makeKeySet(sizes.back());
+    sweepProbes<BloomFilterBuilder>("Bloom", BloomFilter(10), 16, largest);
+    sweepProbes<BlockedBloomFilterBuilder>("BlockedBloom", BlockedBloomFilter(10), blocked::kMaxProbes, largest);
+    benchCuckoo(largest);
+    return 0;
+}
@@ -0,0 +1,300 @@
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <algorithm>
+#include <cstdlib>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "utility/hash.hpp"
+#include "utility/hash_batch.hpp"
+
+// Measures the speed and the quality of every hash function in utility/hash.hpp.
+// Usage: hash_bench [megabytes hashed per function and key size]
+
+using namespace OrangeKV;
+
+namespace {
+    struct HashFunction {
+        const char* name;
+        int bits; // The number of output bits
+        uint64_t (*hash)(const std::string& key);
+    };
+
+    const HashFunction kFunctions[] = {
+        {"HashBKDR", 32, [](const std::string& key) -> uint64_t { return HashBKDR(key, key.size()); }},
+        {"HashDJB", 32, [](const std::string& key) -> uint64_t { return HashDJB(key, key.size()); }},
+        {"HashSDBM", 32, [](const std::string& key) -> uint64_t { return HashSDBM(key, key.size()); }},
+        {"HashAP", 32, [](const std::string& key) -> uint64_t { return HashAP(key, key.size()); }},
+        {"MurmurHash3_x86_32", 32, [](const std::string& key) -> uint64_t { return MurmurHash3_x86_32(key, key.size()); }},
+        {"MurmurHash3_x86_64", 64, [](const std::string& key) -> uint64_t { return MurmurHash3_x86_64(key, key.size()); }},
+        {"MurmurHash3_x64_128", 64, [](const std::string& key) -> uint64_t { return MurmurHash3_x64_128(key).low; }},
+        {"WyHash64", 64, [](const std::string& key) -> uint64_t { return WyHash64(key); }},
+        {"Crc32c", 32, [](const std::string& key) -> uint64_t { return Crc32c(key); }},
+    };
+
+    std::string randomKey(std::mt19937_64& rng, size_t size) {
+        std::string key(size, '\0');
+        for (char& c : key) {
+            c = static_cast<char>(rng());
+        }
+        return key;
+    }
+
+    void benchThroughput(size_t megabytes) {
+        const size_t kSizes[] = {4, 8, 16, 32, 64, 128, 256, 1024, 4096};
+        std::printf("== throughput\n%-20s", "function");
+        for (size_t size : kSizes) {
+            std::printf(" %13zuB", size);
+        }
+        std::printf("\n");
+        std::mt19937_64 rng(301);
+        uint64_t sink = 0;
+        for (const HashFunction& function : kFunctions) {
+            std::printf("%-20s", function.name);
+            for (size_t size : kSizes) {
+                std::vector<std::string> keys;
+                for (int i = 0; i < 256; i++) {
+                    keys.push_back(randomKey(rng, size));
+                }
+                size_t iterations = megabytes * 1024 * 1024 / size;
+                auto start = std::chrono::steady_clock::now();
+                for (size_t i = 0; i < iterations; i++) {
+                    sink += function.hash(keys[i & 255]);
+                }
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                std::printf(" %5.2fGB/s %5.1fns", iterations * size / seconds / 1e9, seconds * 1e9 / iterations);
+            }
+            std::printf("\n");
+        }
+        std::printf("(checksum %llx)\n\n", static_cast<unsigned long long>(sink));
+    }
+
+#if defined(ORANGEKV_CRC32C_X86)
+    // One stream of crc32 instructions, what Crc32c must not be slower than
+    __attribute__((target("sse4.2"), noinline)) uint32_t crc32cOneStream(const uint8_t* p, size_t n) {
+        uint64_t crc = 0xffffffff;
+        for (; n >= 8; n -= 8, p += 8) {
+            crc = _mm_crc32_u64(crc, LoadFixed64(p));
+        }
+        for (; n != 0; n--) {
+            crc = _mm_crc32_u8(static_cast<uint32_t>(crc), *p++);
+        }
+        return ~static_cast<uint32_t>(crc);
+    }
+
+    // Crc32c, which runs three streams side by side from 768 bytes on, against one stream
+    void benchCrc(size_t megabytes) {
+        const size_t kSizes[] = {1024, 4096, 32768};
+        std::printf("== Crc32c against one crc32 stream\n");
+        std::mt19937_64 rng(304);
+        std::string buffer = randomKey(rng, 64 * 1024);
+        const auto* data = reinterpret_cast<const uint8_t*>(buffer.data());
+        uint64_t sink = 0;
+        for (size_t size : kSizes) {
+            for (size_t offset = 0; offset < 8; offset++) {
+                if (Crc32c(data + offset, size) != crc32cOneStream(data + offset, size)) {
+                    std::printf("%5zuB  Crc32c DIFFERS FROM ONE STREAM at offset %zu\n", size, offset);
+                }
+            }
+            size_t iterations = megabytes * 1024 * 1024 / size;
+            size_t slots = buffer.size() / size;
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < iterations; i++) {
+                sink += Crc32c(data + i % slots * size, size);
+            }
+            double crc = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < iterations; i++) {
+                sink += crc32cOneStream(data + i % slots * size, size);
+            }
+            double oneStream = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            double bytes = static_cast<double>(iterations * size);
+            std::printf("%5zuB  Crc32c %6.2fGB/s  one stream %6.2fGB/s  %4.2fx%s\n", size, bytes / crc / 1e9, bytes / oneStream / 1e9,
+                oneStream / crc, crc > oneStream * 1.05 ? "  SLOWER" : "");
+        }
+        std::printf("(checksum %llx)\n\n", static_cast<unsigned long long>(sink));
+    }
+#endif
+
+    // Every batch kernel the CPU can run against MurmurHash3_x86_32, on batches of keys of mixed
+    // lengths, 0 to 3 and lengths that are not a multiple of 4 among them
+    void checkBatch() {
+        std::vector<batch::Murmur32Kernel> kernels = {{&batch::murmur32Scalar, "scalar"}};
+#if defined(ORANGEKV_HASH_BATCH_X86)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            kernels.push_back({&batch::murmur32Avx2, "avx2"});
+        }
+        if (__builtin_cpu_supports("avx512f")) {
+            kernels.push_back({&batch::murmur32Avx512, "avx512"});
+        }
+#endif
+        std::mt19937_64 rng(305);
+        std::vector<std::string> store;
+        for (size_t i = 0; i < 2000; i++) {
+            store.push_back(randomKey(rng, i < 80 ? i : rng() % 300)); // Every length up to 79, then any
+        }
+        std::shuffle(store.begin() + 80, store.end(), rng);
+        std::vector<std::string_view> keys(store.begin(), store.end());
+        const size_t kCounts[] = {0, 1, 3, 7, 8, 9, 15, 16, 17, 31, 33, 100, keys.size()};
+        const uint32_t kSeeds[] = {0, 0x9747b28c};
+        std::printf("== batch kernels against MurmurHash3_x86_32\n");
+        std::vector<uint32_t> out(keys.size());
+        for (const batch::Murmur32Kernel& kernel : kernels) {
+            size_t checked = 0;
+            size_t mismatches = 0;
+            for (size_t offset : {size_t(0), size_t(5)}) { // Batches that start at a key of length 5
+                for (size_t count : kCounts) {
+                    count = std::min(count, keys.size() - offset);
+                    for (uint32_t seed : kSeeds) {
+                        kernel.function(keys.data() + offset, count, seed, out.data());
+                        for (size_t i = 0; i < count; i++) {
+                            std::string_view key = keys[offset + i];
+                            if (out[i] != MurmurHash3_x86_32(key.data(), key.size(), seed) && mismatches++ == 0) {
+                                std::printf("%-8s DIFFERS for a key of length %zu in a batch of %zu\n", kernel.name, key.size(), count);
+                            }
+                        }
+                        checked += count;
+                    }
+                }
+            }
+            std::printf("%-8s %zu hashes checked, %zu differ%s\n", kernel.name, checked, mismatches, mismatches == 0 ? "" : "  DIFFERS");
+        }
+        std::printf("\n");
+    }
+
+    // MurmurHash3_x86_32 one key at a time against MurmurHash3_x86_32_Batch
+    void benchBatch(size_t megabytes) {
+        const size_t kSizes[] = {8, 16, 32, 64, 256};
+        const size_t kBatch = 1024;
+        std::printf("== batch MurmurHash3_x86_32 (kernel %s)\n", MurmurHash3_x86_32_BatchKernel());
+        std::mt19937_64 rng(303);
+        uint64_t sink = 0;
+        std::vector<uint32_t> out(kBatch);
+        for (size_t size : kSizes) {
+            std::vector<std::string> store;
+            for (size_t i = 0; i < kBatch; i++) {
+                store.push_back(randomKey(rng, size));
+            }
+            std::vector<std::string_view> keys(store.begin(), store.end());
+            size_t rounds = std::max<size_t>(1, megabytes * 1024 * 1024 / size / kBatch);
+            auto start = std::chrono::steady_clock::now();
+            for (size_t r = 0; r < rounds; r++) {
+                for (size_t i = 0; i < kBatch; i++) {
+                    out[i] = MurmurHash3_x86_32(keys[i].data(), keys[i].size(), static_cast<uint32_t>(r));
+                }
+                sink += out[r % kBatch];
+            }
+            double scalar = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            start = std::chrono::steady_clock::now();
+            for (size_t r = 0; r < rounds; r++) {
+                MurmurHash3_x86_32_Batch(keys.data(), kBatch, static_cast<uint32_t>(r), out.data());
+                sink += out[r % kBatch];
+            }
+            double batched = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            size_t hashed = rounds * kBatch;
+            std::printf("%5zuB  scalar %6.2fns/key  batch %6.2fns/key  %4.2fx\n", size, scalar * 1e9 / hashed, batched * 1e9 / hashed, scalar / batched);
+        }
+        std::printf("(checksum %llx)\n\n", static_cast<unsigned long long>(sink));
+    }
+
+    // The largest deviation from 50% of the chance that flipping one input bit flips an output bit
+    double worstAvalancheBias(const HashFunction& function, size_t keySize, int samples) {
+        std::mt19937_64 rng(302);
+        std::vector<std::vector<int>> flips(keySize * 8, std::vector<int>(function.bits, 0));
+        for (int s = 0; s < samples; s++) {
+            std::string key = randomKey(rng, keySize);
+            uint64_t base = function.hash(key);
+            for (size_t bit = 0; bit < keySize * 8; bit++) {
+                key[bit / 8] ^= static_cast<char>(1 << (bit % 8));
+                uint64_t diff = base ^ function.hash(key);
+                key[bit / 8] ^= static_cast<char>(1 << (bit % 8));
+                for (int out = 0; out < function.bits; out++) {
+                    flips[bit][out] += (diff >> out) & 1;
+                }
+            }
+        }
+        double worst = 0;
+        for (const auto& row : flips) {
+            for (int count : row) {
+                worst = std::max(worst, std::fabs(static_cast<double>(count) / samples - 0.5) * 2);
+            }
+        }
+        return worst;
+    }
+
+    // Chi-square of the low bits of the hash used as a bucket index, divided by its degrees of
+    // freedom, so about 1.0 is uniform and larger values mean clustering
+    double bucketChiSquare(const HashFunction& function, const std::vector<std::string>& keys, size_t buckets) {
+        std::vector<size_t> load(buckets, 0);
+        for (const std::string& key : keys) {
+            load[function.hash(key) & (buckets - 1)]++;
+        }
+        double expected = static_cast<double>(keys.size()) / buckets;
+        double chi = 0;
+        for (size_t count : load) {
+            chi += (count - expected) * (count - expected) / expected;
+        }
+        return chi / (buckets - 1);
+    }
+
+    // Keys whose 32 low hash bits equal those of an earlier key
+    size_t collisions32(const HashFunction& function, const std::vector<std::string>& keys) {
+        std::unordered_set<uint32_t> seen;
+        size_t collisions = 0;
+        for (const std::string& key : keys) {
+            if (!seen.insert(static_cast<uint32_t>(function.hash(key))).second) {
+                collisions++;
+            }
+        }
+        return collisions;
+    }
+
+    void benchQuality() {
+        const size_t kKeys = 1 << 20;
+        std::vector<std::pair<const char*, std::vector<std::string>>> keySets(3);
+        keySets[0].first = "sequential";
+        keySets[1].first = "numeric-suffix";
+        keySets[2].first = "structured";
+        char buf[64];
+        for (size_t i = 0; i < kKeys; i++) {
+            keySets[0].second.push_back(std::to_string(i));
+            std::snprintf(buf, sizeof(buf), "user:%08zu", i);
+            keySets[1].second.push_back(buf);
+            std::snprintf(buf, sizeof(buf), "tenant/%zu/table/%zu/row/%zu", i % 16, (i / 16) % 64, i / 1024);
+            keySets[2].second.push_back(buf);
+        }
+        double expectedCollisions = static_cast<double>(kKeys) * kKeys / 2 / 4294967296.0;
+        std::printf("== quality (%zu keys per set, %.0f 32 bit collisions expected from a random function)\n", kKeys, expectedCollisions);
+        std::printf("%-20s %10s %10s", "function", "aval-8B", "aval-16B");
+        for (const auto& keySet : keySets) {
+            std::printf(" %16s-chi %14s-coll", keySet.first, keySet.first);
+        }
+        std::printf("\n");
+        for (const HashFunction& function : kFunctions) {
+            std::printf("%-20s %10.3f %10.3f", function.name, worstAvalancheBias(function, 8, 2000), worstAvalancheBias(function, 16, 2000));
+            for (const auto& keySet : keySets) {
+                std::printf(" %20.2f %19zu", bucketChiSquare(function, keySet.second, 1 << 16), collisions32(function, keySet.second));
+            }
+            std::printf("\n");
+        }
+        std::printf("aval: worst bias of an output bit, 0 is ideal and 1 means it never or always flips\n");
+        std::printf("chi: bucket chi-square over 65536 buckets taken from the low bits, about 1 is uniform\n");
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t megabytes = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 64;
+    benchThroughput(megabytes);
+#if defined(ORANGEKV_CRC32C_X86)
+    benchCrc(megabytes);
+#endif
+    checkBatch();
+    benchBatch(megabytes);
+    benchQuality();
+    return 0;
+}
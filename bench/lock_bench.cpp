@@ -0,0 +1,165 @@
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "include/OrangeKV/Lock.hpp"
+#include "include/OrangeKV/LRU.hpp"
+
+// Compares the lock types of include/OrangeKV/Lock.hpp with std::mutex under contention.
+// Usage: lock_bench [max threads] [operations per thread]
+
+using namespace OrangeKV;
+
+namespace {
+    // Run fn(thread index) on every thread at the same time and return the seconds it took
+    template<typename Fn>
+    double runThreads(int threads, Fn fn) {
+        std::atomic<bool> start{false};
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; t++) {
+            workers.emplace_back([&, t] {
+                while (!start.load(std::memory_order_acquire)) {
+                    cpuRelax();
+                }
+                fn(t);
+            });
+        }
+        auto begin = std::chrono::steady_clock::now();
+        start.store(true, std::memory_order_release);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    }
+
+    // A critical section as short as the pointer updates of a cache
+    template<typename Lock>
+    void benchLock(const char* name, int threads, size_t ops) {
+        Lock lock;
+        uint64_t shared[8] = {0};
+        double seconds = runThreads(threads, [&](int) {
+            for (size_t i = 0; i < ops; i++) {
+                std::lock_guard<Lock> guard(lock);
+                shared[i & 7]++;
+            }
+        });
+        uint64_t total = 0;
+        for (uint64_t v : shared) {
+            total += v;
+        }
+        if (total != ops * threads) {
+            std::fprintf(stderr, "%s lost updates: %llu != %llu\n", name, (unsigned long long)total, (unsigned long long)(ops * threads));
+            std::exit(1);
+        }
+        std::printf("%-16s %-10s %3d threads %8.2f Mops/s\n", name, "lock", threads, ops * threads / seconds / 1e6);
+    }
+
+    void deleteValue(const std::string&, int* value) {
+        delete value;
+    }
+
+    // 90% lookUps and 10% inserts on a cache that holds the whole key space
+    template<typename Lock>
+    void benchCache(const char* name, int threads, size_t ops) {
+        constexpr size_t kKeys = 4096;
+        LRUCache<std::string, int, Lock> cache;
+        cache.setCapacity(kKeys);
+        std::vector<std::string> keys;
+        for (size_t i = 0; i < kKeys; i++) {
+            keys.push_back("key" + std::to_string(i));
+            cache.release(cache.insert(keys[i], static_cast<uint32_t>(i), new int(static_cast<int>(i)), 1, &deleteValue));
+        }
+        double seconds = runThreads(threads, [&](int t) {
+            uint64_t x = 88172645463325252ULL + t;
+            for (size_t i = 0; i < ops; i++) {
+                x ^= x << 13;
+                x ^= x >> 7;
+                x ^= x << 17;
+                size_t k = x % kKeys;
+                if (x % 10 == 0) {
+                    cache.release(cache.insert(keys[k], static_cast<uint32_t>(k), new int(static_cast<int>(k)), 1, &deleteValue));
+                }
+                else if (Handle* handle = cache.lookUp(keys[k], static_cast<uint32_t>(k))) {
+                    cache.release(handle);
+                }
+            }
+        });
+        std::printf("%-16s %-10s %3d threads %8.2f Mops/s\n", name, "cache", threads, ops * threads / seconds / 1e6);
+    }
+
+    // The same mix, but the reads go through the shared mode peek path
+    template<typename Lock>
+    void benchCachePeek(const char* name, int threads, size_t ops) {
+        constexpr size_t kKeys = 4096;
+        LRUCache<std::string, int, Lock> cache;
+        cache.setCapacity(kKeys);
+        std::vector<std::string> keys;
+        for (size_t i = 0; i < kKeys; i++) {
+            keys.push_back("key" + std::to_string(i));
+            cache.release(cache.insert(keys[i], static_cast<uint32_t>(i), new int(static_cast<int>(i)), 1, &deleteValue));
+        }
+        std::atomic<uint64_t> sum{0};
+        double seconds = runThreads(threads, [&](int t) {
+            uint64_t x = 88172645463325252ULL + t;
+            uint64_t local = 0;
+            for (size_t i = 0; i < ops; i++) {
+                x ^= x << 13;
+                x ^= x >> 7;
+                x ^= x << 17;
+                size_t k = x % kKeys;
+                if (x % 10 == 0) {
+                    cache.release(cache.insert(keys[k], static_cast<uint32_t>(k), new int(static_cast<int>(k)), 1, &deleteValue));
+                }
+                else {
+                    cache.peek(keys[k], static_cast<uint32_t>(k), [&](const int& value) { local += value; });
+                }
+            }
+            sum.fetch_add(local);
+        });
+        std::printf("%-16s %-10s %3d threads %8.2f Mops/s\n", name, "cache-peek", threads, ops * threads / seconds / 1e6);
+    }
+}
+
+int main(int argc, char** argv) {
+    int maxThreads = argc > 1 ? std::atoi(argv[1]) : static_cast<int>(std::thread::hardware_concurrency());
+    size_t ops = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1000000;
+    if (maxThreads < 1) {
+        maxThreads = 1;
+    }
+    std::vector<int> threadCounts;
+    for (int t = 1; t < maxThreads; t *= 2) {
+        threadCounts.push_back(t);
+    }
+    threadCounts.push_back(maxThreads);
+
+    for (int threads : threadCounts) {
+        benchLock<std::mutex>("std::mutex", threads, ops);
+        benchLock<SpinLock>("SpinLock", threads, ops);
+        benchLock<TicketLock>("TicketLock", threads, ops);
+        benchLock<MCSLock>("MCSLock", threads, ops);
+        benchLock<SharedSpinLock>("SharedSpinLock", threads, ops);
+        if (threads == 1) {
+            benchLock<NullLock>("NullLock", threads, ops);
+        }
+    }
+    for (int threads : threadCounts) {
+        benchCache<std::mutex>("std::mutex", threads, ops / 4);
+        benchCache<SpinLock>("SpinLock", threads, ops / 4);
+        benchCache<TicketLock>("TicketLock", threads, ops / 4);
+        benchCache<MCSLock>("MCSLock", threads, ops / 4);
+        benchCache<SharedSpinLock>("SharedSpinLock", threads, ops / 4);
+        benchCachePeek<std::shared_mutex>("std::shared_mutex", threads, ops / 4);
+        benchCachePeek<SharedSpinLock>("SharedSpinLock", threads, ops / 4);
+        if (threads == 1) {
+            benchCache<NullLock>("NullLock", threads, ops / 4);
+        }
+    }
+    return 0;
+}
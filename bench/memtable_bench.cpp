@@ -0,0 +1,186 @@
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "include/OrangeKV/MemTable.hpp"
+
+// Checks and times the memtable: threads add at once, then every key must be found with its
+// value and iteration must be strictly ordered. The insert throughput of add and of
+// addConcurrently is reported from 1 thread up.
+// Usage: memtable_bench [max threads] [keys in total]
+
+using namespace OrangeKV;
+
+namespace {
+    // Run fn(thread index) on every thread at the same time and return the seconds it took
+    template<typename Fn>
+    double runThreads(int threads, Fn fn) {
+        std::atomic<bool> start{false};
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; t++) {
+            workers.emplace_back([&, t] {
+                while (!start.load(std::memory_order_acquire)) {
+                    std::this_thread::yield(); // There may be more threads than CPUs
+                }
+                fn(t);
+            });
+        }
+        auto begin = std::chrono::steady_clock::now();
+        start.store(true, std::memory_order_release);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    }
+
+    void fail(const char* name, int threads, const std::string& what) {
+        std::fprintf(stderr, "%s %d threads: %s\n", name, threads, what.c_str());
+        std::exit(1);
+    }
+
+    // The i-th key of a thread, ascending in i or scattered over the key space
+    std::string keyOf(int thread, size_t i, bool sequential) {
+        uint64_t id = sequential ? i : i * 0x9e3779b97f4a7c15ULL; // An odd multiplier is a bijection
+        char buf[40];
+        std::snprintf(buf, sizeof(buf), "key%016llx.%02d", static_cast<unsigned long long>(id), thread);
+        return buf;
+    }
+
+    SequenceNumber sequenceOf(int thread, size_t i, size_t perThread) {
+        return static_cast<SequenceNumber>(thread) * perThread + i + 1;
+    }
+
+    // Every key is found with the value added, and iteration visits every entry in order
+    void check(const char* name, const MemTable& memtable, int threads, size_t perThread, bool sequential) {
+        std::string value;
+        bool deleted;
+        for (int t = 0; t < threads; t++) {
+            for (size_t i = 0; i < perThread; i++) {
+                std::string key = keyOf(t, i, sequential);
+                SequenceNumber sequence = sequenceOf(t, i, perThread);
+                if (!memtable.get(LookupKey(key, kMaxSequenceNumber), value, deleted) || deleted) {
+                    fail(name, threads, "lost " + key);
+                }
+                if (value != std::to_string(sequence)) {
+                    fail(name, threads, "wrong value for " + key);
+                }
+            }
+        }
+        InternalKeyComparator compare;
+        MemTable::Iterator it(&memtable);
+        size_t count = 0;
+        std::string last;
+        for (it.seekToFirst(); it.valid(); it.next()) {
+            if (count > 0 && compare(last, it.key()) >= 0) {
+                fail(name, threads, "iteration out of order at entry " + std::to_string(count));
+            }
+            last.assign(it.key());
+            count++;
+        }
+        if (count != threads * perThread) {
+            fail(name, threads, "iterated " + std::to_string(count) + " entries of " + std::to_string(threads * perThread));
+        }
+    }
+
+    void benchAdd(const char* name, MemTableRep rep, bool concurrent, bool sequential, int threads, size_t keys) {
+        size_t perThread = keys / threads;
+        MemTable memtable(rep, keys);
+        // The keys are made first, so the threads only add
+        std::vector<std::vector<std::string>> threadKeys(threads);
+        for (int t = 0; t < threads; t++) {
+            for (size_t i = 0; i < perThread; i++) {
+                threadKeys[t].push_back(keyOf(t, i, sequential));
+            }
+        }
+        double seconds = runThreads(threads, [&](int t) {
+            for (size_t i = 0; i < perThread; i++) {
+                SequenceNumber sequence = sequenceOf(t, i, perThread);
+                if (concurrent) {
+                    memtable.addConcurrently(sequence, ValueType::kValue, threadKeys[t][i], std::to_string(sequence));
+                }
+                else {
+                    memtable.add(sequence, ValueType::kValue, threadKeys[t][i], std::to_string(sequence));
+                }
+            }
+        });
+        check(name, memtable, threads, perThread, sequential);
+        std::printf("%-32s %-10s %3d threads %8.2f Mops/s\n", name, sequential ? "sequential" : "random", threads,
+                    perThread * threads / seconds / 1e6);
+    }
+
+    // Readers iterate and get while the writers add, every entry they see must be in order and
+    // every key a writer has added must be found
+    void checkReadsDuringWrites(int threads, size_t keys) {
+        const char* name = "reads during addConcurrently";
+        size_t perThread = keys / threads;
+        MemTable memtable;
+        std::vector<std::atomic<size_t>> added(threads);
+        std::atomic<int> writing{threads};
+        std::atomic<size_t> scans{0};
+        runThreads(threads + 1, [&](int t) {
+            if (t < threads) {
+                for (size_t i = 0; i < perThread; i++) {
+                    SequenceNumber sequence = sequenceOf(t, i, perThread);
+                    memtable.addConcurrently(sequence, ValueType::kValue, keyOf(t, i, false), std::to_string(sequence));
+                    added[t].store(i + 1, std::memory_order_release);
+                }
+                writing.fetch_sub(1);
+                return;
+            }
+            InternalKeyComparator compare;
+            std::string value;
+            bool deleted;
+            while (writing.load() > 0) {
+                for (int w = 0; w < threads; w++) {
+                    size_t done = added[w].load(std::memory_order_acquire);
+                    if (done > 0 && !memtable.get(LookupKey(keyOf(w, done - 1, false), kMaxSequenceNumber), value, deleted)) {
+                        fail(name, threads, "an added key is not found");
+                    }
+                }
+                MemTable::Iterator it(&memtable);
+                std::string last;
+                bool first = true;
+                for (it.seekToFirst(); it.valid(); it.next()) {
+                    if (!first && compare(last, it.key()) >= 0) {
+                        fail(name, threads, "iteration out of order");
+                    }
+                    last.assign(it.key());
+                    first = false;
+                }
+                scans.fetch_add(1);
+            }
+        });
+        check(name, memtable, threads, perThread, false);
+        std::printf("%-32s %-10s %3d threads %8zu scans ok\n", name, "random", threads, scans.load());
+    }
+}
+
+int main(int argc, char** argv) {
+    int maxThreads = argc > 1 ? std::atoi(argv[1]) : 16;
+    size_t keys = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1000000;
+    if (maxThreads < 1) {
+        maxThreads = 1;
+    }
+    std::vector<int> threadCounts;
+    for (int t = 1; t < maxThreads; t *= 2) {
+        threadCounts.push_back(t);
+    }
+    threadCounts.push_back(maxThreads);
+
+    for (bool sequential : {true, false}) {
+        benchAdd("skiplist add", MemTableRep::kSkipList, false, sequential, 1, keys);
+        for (int threads : threadCounts) {
+            benchAdd("skiplist addConcurrently", MemTableRep::kSkipList, true, sequential, threads, keys);
+        }
+        for (int threads : threadCounts) {
+            benchAdd("hash index addConcurrently", MemTableRep::kHashIndex, true, sequential, threads, keys);
+        }
+    }
+    checkReadsDuringWrites(maxThreads, keys / 10);
+    return 0;
+}
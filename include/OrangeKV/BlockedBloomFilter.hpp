@@ -0,0 +1,208 @@
+#ifndef BLOCKEDBLOOMFILTER_HPP
+#define BLOCKEDBLOOMFILTER_HPP
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <span>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "utility/hash.hpp"
+#include "include/OrangeKV/FilterPolicy.hpp"
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define ORANGEKV_BLOCKED_BLOOM_X86 1
+#include <immintrin.h>
+#endif
+/*
+ * A Bloom filter whose probes for a key all fall in one 64 byte line, so a negative lookUp
+ * costs one cache miss instead of up to k. A line is 16 words of 32 bits; a key sets one bit
+ * in each of k consecutive words (wrapping around) starting at a word picked by its hash.
+ * The filter is the lines followed by the filter trailer. The lines are at 64 byte offsets
+ * from the start of the filter, so they are cache lines only when the filter is 64 byte
+ * aligned, which a std::string is not: filters that are probed often should be held in an
+ * AlignedFilter and probed through keyMayMatchIn.
+ */
+namespace OrangeKV {
+    namespace blocked {
+        constexpr size_t kLineBytes = 64;
+        constexpr size_t kWords = 16;
+        constexpr size_t kMaxProbes = kWords;
+        // Odd multipliers, word i takes its bit index from the top 5 bits of hash * kSalt[i]
+        alignas(64) constexpr uint32_t kSalt[kWords] = {
+            0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU, 0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U,
+            0x8c773fe7U, 0x55dacb8fU, 0xc02373abU, 0x21b8c26bU, 0xbf4f7e61U, 0x5728e6bfU, 0xdd7398f1U, 0x276fbc83U,
+        };
+
+        struct Probe {
+            size_t line; // The index of the line
+            uint32_t start; // The first word
+            uint32_t hash; // Picks the bit in every word
+        };
+
+        inline uint64_t keyHash(std::string_view key) {
+            return WyHash64(key);
+        }
+
+        inline Probe probeOf(uint64_t hash, size_t lines) {
+            uint32_t high = static_cast<uint32_t>(hash >> 32);
+            return Probe{static_cast<size_t>((static_cast<uint64_t>(high) * lines) >> 32), high & static_cast<uint32_t>(kWords - 1), static_cast<uint32_t>(hash)};
+        }
+
+        inline void addToLine(char* line, const Probe& probe, uint32_t k) {
+            for (uint32_t j = 0; j < k; j++) {
+                uint32_t word = (probe.start + j) & (kWords - 1);
+                uint32_t bit = (probe.hash * kSalt[word]) >> 27;
+                line[word * 4 + bit / 8] |= static_cast<char>(1 << (bit % 8));
+            }
+        }
+
+        inline bool lineMayMatchScalar(const char* line, const Probe& probe, uint32_t k) {
+            for (uint32_t j = 0; j < k; j++) {
+                uint32_t word = (probe.start + j) & (kWords - 1);
+                uint32_t bit = (probe.hash * kSalt[word]) >> 27;
+                if ((line[word * 4 + bit / 8] & (1 << (bit % 8))) == 0) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+#if defined(ORANGEKV_BLOCKED_BLOOM_X86)
+        // The bits of a key in 8 of the words, zero in the words it doesn't probe
+        __attribute__((target("avx2"))) inline __m256i probeMask(__m256i words, __m256i start, __m256i k, __m256i hash, const uint32_t* salt) {
+            __m256i distance = _mm256_and_si256(_mm256_sub_epi32(words, start), _mm256_set1_epi32(kWords - 1));
+            __m256i active = _mm256_cmpgt_epi32(k, distance);
+            __m256i bit = _mm256_srli_epi32(_mm256_mullo_epi32(hash, _mm256_load_si256(reinterpret_cast<const __m256i*>(salt))), 27);
+            return _mm256_and_si256(_mm256_sllv_epi32(_mm256_set1_epi32(1), bit), active);
+        }
+
+        // Builds the mask of all 16 words and tests it against the line with two compares
+        __attribute__((target("avx2"))) inline bool lineMayMatchAvx2(const char* line, const Probe& probe, uint32_t k) {
+            __m256i start = _mm256_set1_epi32(static_cast<int>(probe.start));
+            __m256i count = _mm256_set1_epi32(static_cast<int>(k));
+            __m256i hash = _mm256_set1_epi32(static_cast<int>(probe.hash));
+            __m256i low = probeMask(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), start, count, hash, kSalt);
+            __m256i high = probeMask(_mm256_setr_epi32(8, 9, 10, 11, 12, 13, 14, 15), start, count, hash, kSalt + 8);
+            __m256i lowLine = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(line));
+            __m256i highLine = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(line + 32));
+            return _mm256_testc_si256(lowLine, low) & _mm256_testc_si256(highLine, high); // (~line & mask) == 0
+        }
+#endif
+
+        using LineMatchFunction = bool (*)(const char* line, const Probe& probe, uint32_t k);
+
+        inline LineMatchFunction selectLineMatch() {
+#if defined(ORANGEKV_BLOCKED_BLOOM_X86)
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2")) {
+                return &lineMayMatchAvx2;
+            }
+#endif
+            return &lineMayMatchScalar;
+        }
+
+        inline LineMatchFunction lineMatchFunction() {
+            static const LineMatchFunction function = selectLineMatch();
+            return function;
+        }
+    }
+
+    class BlockedBloomFilterBuilder : public FilterBitsBuilder {
+    private:
+        size_t bitsPerKey;
+        uint32_t k;
+        size_t added = 0;
+        FilterHashes<uint64_t> hashes;
+    public:
+        BlockedBloomFilterBuilder(size_t bitsPerKey, uint32_t k) : bitsPerKey(bitsPerKey), k(k) {}
+        void addKey(std::string_view key) override {
+            hashes.add(blocked::keyHash(key));
+            added++;
+        }
+        size_t numAdded() const override {
+            return added;
+        }
+        void finish(std::string& dest) override {
+            std::vector<uint64_t> distinct = hashes.take();
+            size_t lines = (distinct.size() * bitsPerKey + blocked::kLineBytes * 8 - 1) / (blocked::kLineBytes * 8);
+            if (lines < 1) {
+                lines = 1;
+            }
+            size_t start = dest.size();
+            dest.reserve(start + lines * blocked::kLineBytes + kFilterTrailerBytes); // Or appending the trailer doubles the capacity
+            dest.resize(start + lines * blocked::kLineBytes, 0);
+            char* array = &dest[start];
+            for (uint64_t hash : distinct) {
+                blocked::Probe probe = blocked::probeOf(hash, lines);
+                blocked::addToLine(array + probe.line * blocked::kLineBytes, probe, k);
+            }
+            AppendFilterTrailer(dest, k, FilterLayout::kBlockedBloom);
+            added = 0;
+        }
+    };
+
+    class BlockedBloomFilter : public FilterPolicy {
+    private:
+        size_t bitsPerKey;
+        uint32_t k; // The number of probes, at most blocked::kMaxProbes
+    public:
+        explicit BlockedBloomFilter(int bitsPerKey) : bitsPerKey(bitsPerKey < 1 ? 1 : bitsPerKey) {
+            k = static_cast<uint32_t>(this->bitsPerKey * 0.69); // ln(2) = 0.69
+            if (k < 1) {
+                k = 1;
+            }
+            if (k > blocked::kMaxProbes) {
+                k = blocked::kMaxProbes;
+            }
+        }
+        const std::string Name() const override {
+            return "OrangeKV.BlockedBloomFilter";
+        }
+        std::unique_ptr<FilterBitsBuilder> newBuilder() const override {
+            return std::make_unique<BlockedBloomFilterBuilder>(bitsPerKey, k);
+        }
+        bool keyMayMatch(const std::string& key, const std::string& filter) const override {
+            return keyMayMatchIn(key, filter);
+        }
+        bool keyMayMatchIn(std::string_view key, std::string_view filter) const override {
+            FilterTrailer trailer;
+            size_t bytes;
+            if (!ReadFilterTrailer(filter, trailer, bytes) || trailer.layout != FilterLayout::kBlockedBloom
+                || trailer.probes > blocked::kMaxProbes || bytes == 0 || bytes % blocked::kLineBytes != 0) {
+                return true; // Not a filter we can read, so it rules nothing out
+            }
+            size_t lines = bytes / blocked::kLineBytes;
+            blocked::Probe probe = blocked::probeOf(blocked::keyHash(key), lines);
+            return blocked::lineMatchFunction()(filter.data() + probe.line * blocked::kLineBytes, probe, trailer.probes);
+        }
+
+        // A key touches one line, so the lines of all keys are prefetched before any is tested
+        void keysMayMatch(std::span<const std::string_view> keys, const std::string& filter, std::vector<bool>& mayMatch) const override {
+            FilterTrailer trailer;
+            size_t bytes;
+            if (!ReadFilterTrailer(filter, trailer, bytes) || trailer.layout != FilterLayout::kBlockedBloom
+                || trailer.probes > blocked::kMaxProbes || bytes == 0 || bytes % blocked::kLineBytes != 0) {
+                mayMatch.assign(keys.size(), true);
+                return;
+            }
+            size_t lines = bytes / blocked::kLineBytes;
+            std::vector<blocked::Probe> probes(keys.size());
+            for (size_t i = 0; i < keys.size(); i++) {
+                probes[i] = blocked::probeOf(blocked::keyHash(keys[i]), lines);
+                PrefetchFilterLine(filter.data() + probes[i].line * blocked::kLineBytes);
+            }
+            blocked::LineMatchFunction lineMayMatch = blocked::lineMatchFunction();
+            mayMatch.assign(keys.size(), false);
+            for (size_t i = 0; i < keys.size(); i++) {
+                mayMatch[i] = lineMayMatch(filter.data() + probes[i].line * blocked::kLineBytes, probes[i], trailer.probes);
+            }
+        }
+    };
+}
+
+inline const FilterPolicy* NewBlockedBloomFilterPolicy(int bits_per_key) {
+    return new OrangeKV::BlockedBloomFilter(bits_per_key);
+}
+
+#endif // BLOCKEDBLOOMFILTER_HPP
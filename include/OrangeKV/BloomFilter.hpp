@@ -1,63 +1,162 @@
 #ifndef BLOOMFILTER_HPP
 #define BLOOMFILTER_HPP
 
+#include <algorithm>
 #include <vector>
 #include <string>
+#include <string_view>
+#include <memory>
+#include <span>
 #include <unistd.h>
 #include <cstdint>
 #include <cstddef>
 #include "utility/hash.hpp"
+#include "utility/hash_batch.hpp"
 #include "include/OrangeKV/FilterPolicy.hpp"
 namespace OrangeKV {
-    static uint32_t BloomHash(const std::string& key) {
-        return MurmurHash3_x86_32(key, key.size(), 0);
+    static uint32_t BloomHash(std::string_view key) {
+        return MurmurHash3_x86_32(key, 0);
     }
-    class BloomFilter : public FilterPolicy {
+
+    class BloomFilterBuilder : public FilterBitsBuilder {
     private:
         size_t bitsPerKey;
         size_t k; // number of hash functions
+        size_t added = 0;
+        FilterHashes<uint32_t> hashes;
     public:
-        explicit BloomFilter(int bitsPerKey) : bitsPerKey(bitsPerKey) {
-            k = static_cast<size_t>(bitsPerKey * 0.69); // ln(2) = 0.69
-            if (k < 1) {
-                k = 1;
-            }
-            if (k > 30) {
-                k = 30;
-            }
+        BloomFilterBuilder(size_t bitsPerKey, size_t k) : bitsPerKey(bitsPerKey), k(k) {}
+        void addKey(std::string_view key) override {
+            addHash(BloomHash(key));
         }
-        const std::string Name() const override {
-            return "OrangeKV.BloomFilter";
+        void addHash(uint32_t hash) { // Add a key by its BloomHash
+            hashes.add(hash);
+            added++;
+        }
+        size_t numAdded() const override {
+            return added;
         }
-        void createFilter(const std::string& keys, size_t n, std::string& dest) override {
-            // n is the number of keys
-            size_t bits = n * bitsPerKey;
+        void finish(std::string& dest) override {
+            std::vector<uint32_t> distinct = hashes.take();
+            size_t bits = distinct.size() * bitsPerKey;
             if (bits < 64) {
                 bits = 64;
             }
             size_t bytes = (bits + 7) / 8;
             bits = bytes * 8;
-            std::vector<bool> bitsVec(bits, false);
-            for (size_t i = 0; i < n; i++) {
-                uint32_t hash = BloomHash(std::string(1, keys[i]));// 
+            size_t start = dest.size();
+            dest.reserve(start + bytes + kFilterTrailerBytes); // Or appending the trailer doubles the capacity
+            dest.resize(start + bytes, 0);
+            char* array = &dest[start];
+            for (uint32_t hash : distinct) {
                 uint32_t delta = (hash >> 17) | (hash << 15);
                 for (size_t j = 0; j < k; j++) {
                     size_t bitPos = hash % bits;
-                    bitsVec[bitPos] =  bitsVec[bitPos] || true;
+                    array[bitPos / 8] |= static_cast<char>(1 << (bitPos % 8));
                     hash += delta;
                 }
             }
+            AppendFilterTrailer(dest, static_cast<uint32_t>(k), FilterLayout::kBloom);
+            added = 0;
+        }
+    };
+
+    class BloomFilter : public FilterPolicy {
+    private:
+        size_t bitsPerKey;
+        size_t k; // number of hash functions
+    public:
+        static constexpr size_t kMaxProbes = 30;
+
+        explicit BloomFilter(int bitsPerKey) : bitsPerKey(bitsPerKey) {
+            k = static_cast<size_t>(bitsPerKey * 0.69); // ln(2) = 0.69
+            if (k < 1) {
+                k = 1;
+            }
+            if (k > kMaxProbes) {
+                k = kMaxProbes;
+            }
+        }
+        const std::string Name() const override {
+            return "OrangeKV.BloomFilter";
+        }
+        std::unique_ptr<FilterBitsBuilder> newBuilder() const override {
+            return std::make_unique<BloomFilterBuilder>(bitsPerKey, k);
+        }
+        // With every key at hand they are hashed as a batch
+        void createFilter(const std::string* keys, size_t n, std::string& dest) const override {
+            std::vector<std::string_view> views(keys, keys + n);
+            std::vector<uint32_t> hashValues(n);
+            MurmurHash3_x86_32_Batch(views.data(), n, 0, hashValues.data());
+            BloomFilterBuilder builder(bitsPerKey, k);
+            for (uint32_t hash : hashValues) {
+                builder.addHash(hash);
+            }
+            builder.finish(dest);
+        }
+        bool keyMayMatch(const std::string& key, const std::string& filter) const override {
+            return keyMayMatchIn(key, filter);
+        }
+        bool keyMayMatchIn(std::string_view key, std::string_view filter) const override {
+            FilterTrailer trailer;
+            size_t bytes;
+            if (!readable(filter, trailer, bytes)) {
+                return true; // Not a filter we can read, so it rules nothing out
+            }
+            return bytes * 8 >= 64 && hashMayMatch(BloomHash(key), filter.data(), bytes * 8, trailer.probes);
         }
-        bool keyMayMatch(const std::string& key, const std::string& filter) override {
-            size_t bits = filter.size() * 8;
+
+        /**
+         * Hashes every key as a batch, then works through the keys kPrefetchGroup at a time:
+         * the cache lines of all probes of the next group are prefetched before the bits of
+         * the current group are tested, so their misses overlap.
+         */
+        void keysMayMatch(std::span<const std::string_view> keys, const std::string& filter, std::vector<bool>& mayMatch) const override {
+            FilterTrailer trailer;
+            size_t bytes;
+            if (!readable(filter, trailer, bytes)) {
+                mayMatch.assign(keys.size(), true);
+                return;
+            }
+            size_t bits = bytes * 8;
+            mayMatch.assign(keys.size(), false);
             if (bits < 64) {
-                return false;
+                return;
+            }
+            std::vector<uint32_t> hashValues(keys.size());
+            MurmurHash3_x86_32_Batch(keys.data(), keys.size(), 0, hashValues.data());
+            auto prefetch = [&](size_t begin) {
+                size_t end = std::min(begin + kPrefetchGroup, keys.size());
+                for (size_t i = begin; i < end; i++) {
+                    uint32_t hash = hashValues[i];
+                    uint32_t delta = (hash >> 17) | (hash << 15);
+                    for (size_t j = 0; j < trailer.probes; j++) {
+                        PrefetchFilterLine(filter.data() + (hash % bits) / 8);
+                        hash += delta;
+                    }
+                }
+            };
+            prefetch(0);
+            for (size_t begin = 0; begin < keys.size(); begin += kPrefetchGroup) {
+                prefetch(begin + kPrefetchGroup);
+                size_t end = std::min(begin + kPrefetchGroup, keys.size());
+                for (size_t i = begin; i < end; i++) {
+                    mayMatch[i] = hashMayMatch(hashValues[i], filter.data(), bits, trailer.probes);
+                }
             }
-            uint32_t hash = BloomHash(key);
+        }
+    private:
+        static constexpr size_t kPrefetchGroup = 8; // Keys whose probes are in flight at once
+
+        static bool readable(std::string_view filter, FilterTrailer& trailer, size_t& bytes) {
+            return ReadFilterTrailer(filter, trailer, bytes) && trailer.layout == FilterLayout::kBloom && trailer.probes <= kMaxProbes;
+        }
+
+        static bool hashMayMatch(uint32_t hash, const char* array, size_t bits, uint32_t probes) {
             uint32_t delta = (hash >> 17) | (hash << 15);
-            for (size_t i = 0; i < k; i++) {
+            for (size_t i = 0; i < probes; i++) {
                 size_t bitPos = hash % bits;
-                if ((filter[bitPos / 8] & (1 << (bitPos % 8))) == 0) {
+                if ((array[bitPos / 8] & (1 << (bitPos % 8))) == 0) {
                     return false;
                 }
                 hash += delta;
@@ -67,5 +166,8 @@ namespace OrangeKV {
     };
 }
 
+inline const FilterPolicy* NewBloomFilterPolicy(int bits_per_key) {
+    return new OrangeKV::BloomFilter(bits_per_key);
+}
 
-#endif // BLOOMFILTER_HPP
\ No newline at end of file
+#endif // BLOOMFILTER_HPP
@@ -0,0 +1,447 @@
+#ifndef ORANGEKV_CACHE_HPP
+#define ORANGEKV_CACHE_HPP
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstddef>
+#include <concepts>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include "utility/hash.hpp"
+#include "utility/slab_allocator.hpp"
+#include "utility/memory_report.hpp"
+#include "include/OrangeKV/Lock.hpp"
+namespace OrangeKV {
+    struct Handle {};
+
+    // A doubly linked list threaded through the prev/next links of the eviction hook of each node
+    template<typename Node>
+    class IntrusiveList {
+    private:
+        Node* head = nullptr; // The most recently added node
+        Node* tail = nullptr; // The least recently added node
+    public:
+        bool empty() const {
+            return head == nullptr;
+        }
+        Node* back() const {
+            return tail;
+        }
+        void pushFront(Node* node) {
+            node->hook.prev = nullptr;
+            node->hook.next = head;
+            if (head != nullptr) {
+                head->hook.prev = node;
+            }
+            else {
+                tail = node;
+            }
+            head = node;
+        }
+        void remove(Node* node) {
+            if (node->hook.prev != nullptr) {
+                node->hook.prev->hook.next = node->hook.next;
+            }
+            else {
+                head = node->hook.next;
+            }
+            if (node->hook.next != nullptr) {
+                node->hook.next->hook.prev = node->hook.prev;
+            }
+            else {
+                tail = node->hook.prev;
+            }
+            node->hook.prev = node->hook.next = nullptr;
+        }
+    };
+
+    /*
+     * Eviction policies. The cache only hands a policy the nodes that may be evicted, that is
+     * the nodes in the cache that no client holds a handle to: add() is called when a node
+     * becomes evictable, remove() when it is pinned or erased, touch() on every lookUp hit and
+     * victim() picks the next node to evict. Every node carries the Hook of its policy.
+     */
+
+    // Evict the node that was released the longest time ago
+    struct LRUPolicy {
+        template<typename Node>
+        struct Hook {
+            Node* prev = nullptr;
+            Node* next = nullptr;
+        };
+        template<typename Node>
+        class Queue {
+        private:
+            IntrusiveList<Node> list;
+        public:
+            void add(Node* node) {
+                list.pushFront(node);
+            }
+            void remove(Node* node) {
+                list.remove(node);
+            }
+            void touch(Node*) {}
+            Node* victim() const {
+                return list.back();
+            }
+            bool empty() const {
+                return list.empty();
+            }
+        };
+    };
+
+    // Evict the node with the fewest lookUps, the least recently released one among equals
+    struct LFUPolicy {
+        template<typename Node>
+        struct Hook {
+            Node* prev = nullptr;
+            Node* next = nullptr;
+            uint32_t frequency = 1;
+        };
+        template<typename Node>
+        class Queue {
+        private:
+            std::map<uint32_t, IntrusiveList<Node>> buckets; // The evictable nodes of each frequency
+        public:
+            void add(Node* node) {
+                buckets[node->hook.frequency].pushFront(node);
+            }
+            void remove(Node* node) {
+                auto it = buckets.find(node->hook.frequency);
+                it->second.remove(node);
+                if (it->second.empty()) {
+                    buckets.erase(it);
+                }
+            }
+            void touch(Node* node) { // Only called on pinned nodes, which are in no bucket
+                if (node->hook.frequency < std::numeric_limits<uint32_t>::max()) {
+                    node->hook.frequency++;
+                }
+            }
+            Node* victim() const {
+                return buckets.begin()->second.back();
+            }
+            bool empty() const {
+                return buckets.empty();
+            }
+        };
+    };
+
+    // Charge policies decide how much of the capacity an entry takes
+
+    // The charge passed to insert
+    struct ExplicitCharge {
+        template<typename KeyType, typename ValueType>
+        static size_t charge(const KeyType&, const ValueType*, size_t charge) {
+            return charge;
+        }
+    };
+
+    // One per entry, so the capacity is the number of entries
+    struct EntryCountCharge {
+        template<typename KeyType, typename ValueType>
+        static size_t charge(const KeyType&, const ValueType*, size_t) {
+            return 1;
+        }
+    };
+
+    // Allocation policies decide where the nodes of the cache and of its index come from
+
+    // operator new
+    struct HeapAllocation {
+        template<typename T>
+        using Allocator = std::allocator<T>;
+
+        static size_t allocatedBytes(size_t bytes) { // The chunk glibc malloc takes, a header and 16 byte rounding
+            return std::max<size_t>((bytes + sizeof(size_t) + 15) & ~size_t(15), 32);
+        }
+    };
+
+    // The size classes of SlabAllocator, so inserts and evictions don't go to malloc
+    struct SlabAllocation {
+        template<typename T>
+        using Allocator = SlabStdAllocator<T>;
+
+        static size_t allocatedBytes(size_t bytes) {
+            return SlabAllocator::allocatedBytes(bytes);
+        }
+    };
+
+    template<typename KeyType, typename ValueType, typename EvictionPolicy>
+    struct CacheNode {
+        void (*deleter)(const KeyType& key, ValueType* value);
+        KeyType key;
+        ValueType* value;
+        size_t charge;
+        uint32_t hash;
+        uint32_t refs;
+        bool inCache;
+        typename EvictionPolicy::template Hook<CacheNode> hook;
+    };
+
+    template<typename P, typename Node>
+    concept EvictionPolicyFor = requires(typename P::template Queue<Node> queue, const typename P::template Queue<Node> constQueue, Node* node) {
+        queue.add(node);
+        queue.remove(node);
+        queue.touch(node);
+        { constQueue.victim() } -> std::same_as<Node*>;
+        { constQueue.empty() } -> std::convertible_to<bool>;
+    };
+
+    template<typename L>
+    concept LockPolicyType = std::default_initializable<L> && requires(L& lock) {
+        lock.lock();
+        lock.unlock();
+    };
+
+    // A lock that can also be held in shared mode by readers, such as SharedSpinLock or std::shared_mutex
+    template<typename L>
+    concept SharedLockPolicyType = LockPolicyType<L> && requires(L& lock) {
+        lock.lock_shared();
+        lock.unlock_shared();
+    };
+
+    template<typename H, typename KeyType>
+    concept HashPolicyFor = std::default_initializable<H> && std::is_invocable_r_v<size_t, const H&, const KeyType&>;
+
+    template<typename C, typename KeyType, typename ValueType>
+    concept ChargePolicyFor = requires(const KeyType& key, const ValueType* value, size_t charge) {
+        { C::charge(key, value, charge) } -> std::convertible_to<size_t>;
+    };
+
+    template<typename A, typename Node>
+    concept AllocationPolicyFor = requires(typename A::template Allocator<Node> allocator, Node* node, size_t bytes) {
+        { allocator.allocate(1) } -> std::same_as<Node*>;
+        allocator.deallocate(node, 1);
+        { A::allocatedBytes(bytes) } -> std::convertible_to<size_t>;
+    };
+
+    /**
+     * A reference counted cache whose behaviour is put together from policies at compile time:
+     * EvictionPolicy picks the entry to evict, LockPolicy guards the cache (NullLock compiles
+     * the locking out), HashPolicy hashes the keys of the index and ChargePolicy decides how
+     * much of the capacity an entry takes and AllocationPolicy where the nodes of the cache and
+     * of its index are allocated. Entries that are held through a handle are never
+     * evicted, they are freed when the last handle is released.
+     */
+    template<typename KeyType, typename ValueType,
+             typename EvictionPolicy = LRUPolicy,
+             typename LockPolicy = std::mutex,
+             typename HashPolicy = BKDRHasher,
+             typename ChargePolicy = ExplicitCharge,
+             typename AllocationPolicy = SlabAllocation>
+        requires EvictionPolicyFor<EvictionPolicy, CacheNode<KeyType, ValueType, EvictionPolicy>>
+            && LockPolicyType<LockPolicy> && HashPolicyFor<HashPolicy, KeyType>
+            && ChargePolicyFor<ChargePolicy, KeyType, ValueType>
+            && AllocationPolicyFor<AllocationPolicy, CacheNode<KeyType, ValueType, EvictionPolicy>>
+    class Cache {
+    public:
+        using Node = CacheNode<KeyType, ValueType, EvictionPolicy>;
+        using Deleter = void (*)(const KeyType& key, ValueType* value);
+    private:
+        size_t capacity_; // The maximum capacity of the cache
+        size_t usage_; // The total charge of the cache
+        using TableAllocator = typename AllocationPolicy::template Allocator<std::pair<const KeyType, Node*>>;
+        std::unordered_map<KeyType, Node*, HashPolicy, std::equal_to<KeyType>, TableAllocator> table; // The map of keys to nodes
+        typename EvictionPolicy::template Queue<Node> queue; // The nodes that may be evicted
+        mutable LockPolicy locker; // The locker for thread safety
+        typename AllocationPolicy::template Allocator<Node> nodeAllocator;
+    public:
+        Cache() : capacity_(0), usage_(0) {}
+        Cache(const Cache&) = delete;
+        Cache& operator=(const Cache&) = delete;
+        ~Cache() {
+            for (auto& entry : table) {
+                Node* node = entry.second;
+                assert(node->refs == 1); // Every handle must be released before the cache is destroyed
+                queue.remove(node);
+                node->inCache = false;
+                unref(node);
+            }
+        }
+
+        /**
+         * @brief Inserts a key, replacing the entry of the key if there is one.
+         *
+         * @return A handle to the new entry, which must be passed to release.
+         */
+        Handle* insert(const KeyType& key, uint32_t hash, ValueType* value, size_t charge, Deleter deleter) {
+            std::lock_guard<LockPolicy> lock(locker);
+            Node* node = new (nodeAllocator.allocate(1)) Node{deleter, key, value, ChargePolicy::charge(key, value, charge), hash, 2, true, {}};
+            auto [it, inserted] = table.try_emplace(node->key, node);
+            if (!inserted) {
+                Node* old = it->second;
+                it->second = node;
+                finishErase(old);
+            }
+            usage_ += node->charge;
+            while (usage_ > capacity_ && !queue.empty()) {
+                Node* victim = queue.victim();
+                assert(victim->refs == 1);
+                table.erase(victim->key);
+                finishErase(victim);
+            }
+            return reinterpret_cast<Handle*>(node);
+        }
+
+        // Look up a key, the entry is pinned until the handle is released
+        Handle* lookUp(const KeyType& key, uint32_t hash) {
+            std::lock_guard<LockPolicy> lock(locker);
+            auto it = table.find(key);
+            if (it == table.end() || it->second->hash != hash) {
+                return nullptr;
+            }
+            Node* node = it->second;
+            ref(node);
+            queue.touch(node);
+            return reinterpret_cast<Handle*>(node);
+        }
+
+        /**
+         * @brief Reads the value of a key in place, without pinning it.
+         *
+         * This is the read only path of the cache: it does not count as a use of the entry for
+         * eviction, so with a SharedLockPolicyType lock it only takes the lock in shared mode
+         * and concurrent peeks don't serialize. fn is called with the value under the lock.
+         *
+         * @return false if the key is not in the cache.
+         */
+        template<typename Fn>
+        bool peek(const KeyType& key, uint32_t hash, Fn&& fn) {
+            if constexpr (SharedLockPolicyType<LockPolicy>) {
+                std::shared_lock<LockPolicy> lock(locker);
+                return peekLocked(key, hash, fn);
+            }
+            else {
+                std::lock_guard<LockPolicy> lock(locker);
+                return peekLocked(key, hash, fn);
+            }
+        }
+
+        void release(Handle* handle) {
+            std::lock_guard<LockPolicy> lock(locker);
+            unref(reinterpret_cast<Node*>(handle));
+        }
+
+        void erase(const KeyType& key, uint32_t hash) {
+            std::lock_guard<LockPolicy> lock(locker);
+            auto it = table.find(key);
+            if (it != table.end() && it->second->hash == hash) {
+                Node* node = it->second;
+                table.erase(it);
+                finishErase(node);
+            }
+        }
+
+        // Evict every entry that no client holds a handle to
+        void prune() {
+            std::lock_guard<LockPolicy> lock(locker);
+            while (!queue.empty()) {
+                Node* node = queue.victim();
+                table.erase(node->key);
+                finishErase(node);
+            }
+        }
+
+        ValueType* value(Handle* handle) const { // Get the value of a handle returned by insert or lookUp
+            return reinterpret_cast<Node*>(handle)->value;
+        }
+        void setCapacity(size_t capacity) { // Set the maximum capacity of the cache
+            capacity_ = capacity;
+        }
+        size_t capacity() const { // Get the maximum capacity of the cache
+            return capacity_;
+        }
+        size_t totalCharge() const { // Get the total charge of the cache
+            std::lock_guard<LockPolicy> lock(locker);
+            return usage_;
+        }
+
+        /**
+         * @brief Adds the memory of the cache to a report.
+         *
+         * name.index is the nodes of the cache and of the map, which hold the keys inline, and
+         * the buckets of the map, all overhead. name.keys is the keys that live on the heap,
+         * twice each since the node and the map both keep a copy, and name.values is the
+         * charge of the values, which is their size in bytes with ExplicitCharge and a byte
+         * charge. The map nodes are sized as libstdc++ lays them out.
+         */
+        void reportMemory(MemoryReport& report, std::string_view name) {
+            std::lock_guard<LockPolicy> lock(locker);
+            std::string prefix(name);
+            size_t tableNode = AllocationPolicy::allocatedBytes(sizeof(void*) + sizeof(std::pair<const KeyType, Node*>) + sizeof(size_t));
+            size_t index = table.size() * (AllocationPolicy::allocatedBytes(sizeof(Node)) + tableNode) + table.bucket_count() * sizeof(void*);
+            report.add(prefix + ".index", index, 0);
+            if constexpr (requires(const KeyType& key) { key.size(); key.capacity(); key.data(); }) {
+                size_t allocated = 0;
+                size_t used = 0;
+                for (const auto& [key, node] : table) {
+                    size_t heap = heapBytes(key) + heapBytes(node->key);
+                    allocated += heap;
+                    used += heap > 0 ? key.size() : 0;
+                }
+                report.add(prefix + ".keys", allocated, used);
+            }
+            report.add(prefix + ".values", usage_, usage_);
+        }
+    private:
+        // The heap memory of a string-like key, 0 if it is kept inline
+        static size_t heapBytes(const KeyType& key) {
+            const char* data = reinterpret_cast<const char*>(key.data());
+            const char* object = reinterpret_cast<const char*>(&key);
+            if (data >= object && data < object + sizeof(KeyType)) {
+                return 0;
+            }
+            return HeapAllocation::allocatedBytes((key.capacity() + 1) * sizeof(*key.data())); // Keys allocate for themselves
+        }
+
+        template<typename Fn>
+        bool peekLocked(const KeyType& key, uint32_t hash, Fn& fn) const {
+            auto it = table.find(key);
+            if (it == table.end() || it->second->hash != hash) {
+                return false;
+            }
+            fn(static_cast<const ValueType&>(*it->second->value));
+            return true;
+        }
+
+        void ref(Node* node) {
+            if (node->refs == 1 && node->inCache) { // The node is pinned, it can't be evicted any more
+                queue.remove(node);
+            }
+            node->refs++;
+        }
+
+        void unref(Node* node) {
+            node->refs--;
+            if (node->refs == 0) {
+                (*node->deleter)(node->key, node->value);
+                node->~Node();
+                nodeAllocator.deallocate(node, 1);
+            }
+            else if (node->refs == 1 && node->inCache) { // Only the cache holds the node, it can be evicted
+                queue.add(node);
+            }
+        }
+
+        // Drop the reference of the cache to a node that was removed from the table
+        void finishErase(Node* node) {
+            assert(node->inCache);
+            if (node->refs == 1) {
+                queue.remove(node);
+            }
+            node->inCache = false;
+            usage_ -= node->charge;
+            unref(node);
+        }
+    };
+}
+#endif // ORANGEKV_CACHE_HPP
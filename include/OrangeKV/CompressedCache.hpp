@@ -0,0 +1,152 @@
+#ifndef ORANGEKV_COMPRESSEDCACHE_HPP
+#define ORANGEKV_COMPRESSEDCACHE_HPP
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <string_view>
+#include "utility/compress.hpp"
+#include "include/OrangeKV/LRU.hpp"
+namespace OrangeKV {
+    struct CompressionOptions {
+        bool enabled = true;
+        size_t minSize = 256; // Values smaller than this are stored as they are
+        double maxRatio = 0.875; // Keep the compressed form only if it is at most this fraction of the value
+    };
+
+    struct CompressionStats {
+        uint64_t rawBytes; // The bytes of the values inserted
+        uint64_t storedBytes; // The bytes charged against the capacity for those values
+        uint64_t compressedValues; // The values stored compressed
+        uint64_t plainValues; // The values stored as they are
+        uint64_t decodes; // The lookUps that had to decompress
+        uint64_t decodeNanos; // The time spent decompressing
+        double ratio() const { // How many times smaller the values are in the cache
+            return storedBytes == 0 ? 1.0 : static_cast<double>(rawBytes) / storedBytes;
+        }
+        double decodeNanosPerValue() const {
+            return decodes == 0 ? 0.0 : static_cast<double>(decodeNanos) / decodes;
+        }
+    };
+
+    // The value kept in the cache, data holds the compressed bytes if compressed is set
+    struct CompressedValue {
+        std::string data;
+        size_t rawLength;
+        bool compressed;
+    };
+
+    /**
+     * An LRUCache of byte string values that stores large compressible values compressed.
+     * The charge of an entry is the size it takes in the cache, so compression lets more
+     * entries fit in the same capacity. Values are only decompressed when they are looked
+     * up, outside of the cache lock while the entry is pinned.
+     */
+    template<typename KeyType, typename LockType>
+    class CompressedLRUCache {
+    private:
+        LRUCache<KeyType, CompressedValue, LockType> cache;
+        CompressionOptions options_;
+        std::atomic<uint64_t> rawBytes{0};
+        std::atomic<uint64_t> storedBytes{0};
+        std::atomic<uint64_t> compressedValues{0};
+        std::atomic<uint64_t> plainValues{0};
+        std::atomic<uint64_t> decodes{0};
+        std::atomic<uint64_t> decodeNanos{0};
+    public:
+        explicit CompressedLRUCache(const CompressionOptions& options = CompressionOptions()) : options_(options) {}
+
+        void insert(const KeyType& key, uint32_t hash, std::string_view value) {
+            CompressedValue* stored = new CompressedValue{std::string(), value.size(), false};
+            if (options_.enabled && value.size() >= options_.minSize) {
+                stored->data.resize(LZMaxCompressedLength(value.size()));
+                size_t length = LZCompress(value.data(), value.size(), stored->data.data(), stored->data.size());
+                if (length != 0 && length <= value.size() * options_.maxRatio) {
+                    stored->data.resize(length);
+                    stored->data.shrink_to_fit();
+                    stored->compressed = true;
+                }
+            }
+            if (!stored->compressed) {
+                stored->data.assign(value.data(), value.size());
+            }
+            rawBytes.fetch_add(value.size(), std::memory_order_relaxed);
+            storedBytes.fetch_add(stored->data.size(), std::memory_order_relaxed);
+            (stored->compressed ? compressedValues : plainValues).fetch_add(1, std::memory_order_relaxed);
+            cache.release(cache.insert(key, hash, stored, stored->data.size(), &deleteValue));
+        }
+
+        /**
+         * @brief Looks up a key and writes its value into a caller provided buffer.
+         *
+         * The buffer is reused, so a caller that looks up many keys with the same
+         * buffer only allocates when a value is larger than any before it.
+         *
+         * @return false if the key is not in the cache or its value can't be decoded.
+         */
+        bool lookUp(const KeyType& key, uint32_t hash, std::string& dest) {
+            Handle* handle = cache.lookUp(key, hash);
+            if (handle == nullptr) {
+                return false;
+            }
+            const CompressedValue* stored = cache.value(handle);
+            bool ok = true;
+            if (stored->compressed) {
+                auto start = std::chrono::steady_clock::now();
+                dest.resize(stored->rawLength);
+                ok = LZDecompress(stored->data.data(), stored->data.size(), dest.data(), stored->rawLength);
+                auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+                decodes.fetch_add(1, std::memory_order_relaxed);
+                decodeNanos.fetch_add(static_cast<uint64_t>(nanos.count()), std::memory_order_relaxed);
+            }
+            else {
+                dest.assign(stored->data);
+            }
+            cache.release(handle);
+            return ok;
+        }
+
+        /**
+         * @brief Looks up a key and decompresses it into a buffer pooled per thread.
+         *
+         * @return A view of the value that stays valid until the next lookUp on the same
+         *         thread, or an empty view with found set to false if there is no value.
+         */
+        std::string_view lookUp(const KeyType& key, uint32_t hash, bool* found = nullptr) {
+            thread_local std::string buffer;
+            bool ok = lookUp(key, hash, buffer);
+            if (found != nullptr) {
+                *found = ok;
+            }
+            return ok ? std::string_view(buffer) : std::string_view();
+        }
+
+        void erase(const KeyType& key, uint32_t hash) {
+            cache.erase(key, hash);
+        }
+        void prune() {
+            cache.prune();
+        }
+        void setCapacity(size_t capacity) {
+            cache.setCapacity(capacity);
+        }
+        size_t capacity() const {
+            return cache.capacity();
+        }
+        size_t totalCharge() const { // The bytes of the stored values, after compression
+            return cache.totalCharge();
+        }
+        CompressionStats stats() const {
+            return CompressionStats{rawBytes.load(std::memory_order_relaxed), storedBytes.load(std::memory_order_relaxed),
+                                    compressedValues.load(std::memory_order_relaxed), plainValues.load(std::memory_order_relaxed),
+                                    decodes.load(std::memory_order_relaxed), decodeNanos.load(std::memory_order_relaxed)};
+        }
+    private:
+        static void deleteValue(const KeyType& key, CompressedValue* value) {
+            (void)key;
+            delete value;
+        }
+    };
+}
+#endif // ORANGEKV_COMPRESSEDCACHE_HPP
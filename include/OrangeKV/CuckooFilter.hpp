@@ -0,0 +1,258 @@
+#ifndef CUCKOOFILTER_HPP
+#define CUCKOOFILTER_HPP
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "utility/hash.hpp"
+#include "utility/memory_report.hpp"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+/*
+ * A cuckoo filter (Fan et al., "Cuckoo Filter: Practically Better Than Bloom") which, unlike
+ * the filters of a FilterPolicy, can be changed after it is built: keys can be inserted and
+ * erased at any time. Every key keeps a fingerprint in one of two buckets of kSlots slots,
+ * the second bucket is the first xor a hash of the fingerprint, so a fingerprint can move
+ * between its buckets without the key. A bucket is one integer of kSlots lanes, a lookUp
+ * compares the fingerprint against both buckets at once with SSE2, or with a SWAR zero lane
+ * test where it is not available.
+ *
+ * Only erase keys that were inserted: erasing any other key may drop the fingerprint of a
+ * key that shares it. The filter is not thread safe.
+ */
+namespace OrangeKV {
+    namespace cuckoo {
+        constexpr size_t kSlots = 4;
+        constexpr uint32_t kMaxKicks = 500;
+        constexpr double kLoadFactor = 0.95; // The load a filter of 4 slots per bucket fills to
+
+        // A lookUp compares 2 * kSlots fingerprints, each matching with probability 2^-bits
+        inline uint32_t fingerprintBitsFor(double fpr) {
+            if (!(fpr < 1)) {
+                return 1;
+            }
+            return static_cast<uint32_t>(std::ceil(std::log2(2 * kSlots / std::max(fpr, 1e-12))));
+        }
+    }
+
+    template<typename Fingerprint>
+    class BasicCuckooFilter {
+        static_assert(std::is_same_v<Fingerprint, uint8_t> || std::is_same_v<Fingerprint, uint16_t>, "fingerprints are 8 or 16 bits");
+    private:
+        using Bucket = std::conditional_t<sizeof(Fingerprint) == 1, uint32_t, uint64_t>;
+        static constexpr uint32_t kWidth = sizeof(Fingerprint) * 8;
+        static constexpr Bucket kLaneMask = static_cast<Bucket>((Bucket(1) << kWidth) - 1);
+        static constexpr Bucket kLanes = static_cast<Bucket>(~Bucket(0)) / kLaneMask; // 1 in every lane
+        static constexpr Bucket kHighBits = kLanes << (kWidth - 1);
+
+        struct Victim {
+            bool used = false;
+            size_t index = 0;
+            Fingerprint fingerprint = 0;
+        };
+
+        std::vector<Bucket> buckets;
+        size_t mask; // buckets.size() - 1
+        uint32_t bits;
+        Fingerprint fingerprintMask;
+        size_t count = 0;
+        Victim victim; // The fingerprint left over when an insert ran out of kicks
+        uint64_t random = 0x9e3779b97f4a7c15ULL;
+
+        static Fingerprint lane(Bucket bucket, size_t slot) {
+            return static_cast<Fingerprint>((bucket >> (slot * kWidth)) & kLaneMask);
+        }
+        static void setLane(Bucket& bucket, size_t slot, Fingerprint fingerprint) {
+            bucket = (bucket & ~(kLaneMask << (slot * kWidth))) | (static_cast<Bucket>(fingerprint) << (slot * kWidth));
+        }
+        static bool hasFingerprint(Bucket bucket, Fingerprint fingerprint) {
+            Bucket x = bucket ^ (kLanes * fingerprint);
+            return ((x - kLanes) & ~x & kHighBits) != 0; // Some lane of x is zero
+        }
+
+        void locate(std::string_view key, size_t& index, Fingerprint& fingerprint) const {
+            uint64_t hash = WyHash64(key);
+            fingerprint = static_cast<Fingerprint>(hash & fingerprintMask);
+            if (fingerprint == 0) { // 0 marks an empty slot
+                fingerprint = 1;
+            }
+            index = static_cast<size_t>(hash >> 32) & mask;
+        }
+        size_t altIndex(size_t index, Fingerprint fingerprint) const {
+            return (index ^ (static_cast<size_t>(fingerprint) * 0x5bd1e995)) & mask;
+        }
+
+        bool probe(size_t i1, size_t i2, Fingerprint fingerprint) const {
+#if defined(__SSE2__)
+            __m128i pair;
+            __m128i match;
+            if constexpr (sizeof(Fingerprint) == 1) {
+                pair = _mm_set_epi32(0, 0, static_cast<int>(buckets[i2]), static_cast<int>(buckets[i1]));
+                match = _mm_cmpeq_epi8(pair, _mm_set1_epi8(static_cast<char>(fingerprint))); // The zero lanes never match
+            }
+            else {
+                pair = _mm_set_epi64x(static_cast<long long>(buckets[i2]), static_cast<long long>(buckets[i1]));
+                match = _mm_cmpeq_epi16(pair, _mm_set1_epi16(static_cast<short>(fingerprint)));
+            }
+            return _mm_movemask_epi8(match) != 0;
+#else
+            return hasFingerprint(buckets[i1], fingerprint) || hasFingerprint(buckets[i2], fingerprint);
+#endif
+        }
+
+        bool tryPut(size_t index, Fingerprint fingerprint) {
+            Bucket& bucket = buckets[index];
+            for (size_t slot = 0; slot < cuckoo::kSlots; slot++) {
+                if (lane(bucket, slot) == 0) {
+                    setLane(bucket, slot, fingerprint);
+                    return true;
+                }
+            }
+            return false;
+        }
+        bool tryRemove(size_t index, Fingerprint fingerprint) {
+            Bucket& bucket = buckets[index];
+            if (!hasFingerprint(bucket, fingerprint)) {
+                return false;
+            }
+            for (size_t slot = 0; slot < cuckoo::kSlots; slot++) {
+                if (lane(bucket, slot) == fingerprint) {
+                    setLane(bucket, slot, 0);
+                    return true;
+                }
+            }
+            return false;
+        }
+        uint64_t nextRandom() { // xorshift64
+            random ^= random << 13;
+            random ^= random >> 7;
+            random ^= random << 17;
+            return random;
+        }
+
+        // Place a fingerprint by kicking others to their other bucket, false if it is left in the victim
+        bool place(size_t index, Fingerprint fingerprint) {
+            for (uint32_t kick = 0; kick < cuckoo::kMaxKicks; kick++) {
+                size_t slot = nextRandom() % cuckoo::kSlots;
+                Fingerprint kicked = lane(buckets[index], slot);
+                setLane(buckets[index], slot, fingerprint);
+                fingerprint = kicked;
+                index = altIndex(index, fingerprint);
+                if (tryPut(index, fingerprint)) {
+                    return true;
+                }
+            }
+            victim = Victim{true, index, fingerprint};
+            return false;
+        }
+    public:
+        /**
+         * @brief Sizes a filter for a number of keys and a false positive rate.
+         *
+         * @param expectedKeys The number of keys the filter must hold at once.
+         * @param fpr The target false positive rate, limited by the bits of Fingerprint.
+         */
+        BasicCuckooFilter(size_t expectedKeys, double fpr) {
+            size_t wanted = static_cast<size_t>(std::ceil(static_cast<double>(expectedKeys) / (cuckoo::kSlots * cuckoo::kLoadFactor)));
+            buckets.assign(std::bit_ceil(std::max<size_t>(wanted, 1)), 0);
+            mask = buckets.size() - 1;
+            bits = std::clamp<uint32_t>(cuckoo::fingerprintBitsFor(fpr), 1, kWidth);
+            fingerprintMask = static_cast<Fingerprint>(kLaneMask >> (kWidth - bits));
+        }
+
+        /**
+         * @brief Inserts a key, a key inserted n times has to be erased n times.
+         *
+         * @return false if the filter is full, the key is not inserted then.
+         */
+        bool insert(std::string_view key) {
+            if (victim.used) {
+                return false;
+            }
+            size_t index;
+            Fingerprint fingerprint;
+            locate(key, index, fingerprint);
+            count++;
+            if (tryPut(index, fingerprint)) {
+                return true;
+            }
+            size_t alt = altIndex(index, fingerprint);
+            if (tryPut(alt, fingerprint)) {
+                return true;
+            }
+            place((nextRandom() & 1) ? alt : index, fingerprint);
+            return true; // Even if it is left in the victim, which is checked by every lookUp
+        }
+
+        // Erase an inserted key, false if its fingerprint is not in the filter
+        bool erase(std::string_view key) {
+            size_t index;
+            Fingerprint fingerprint;
+            locate(key, index, fingerprint);
+            size_t alt = altIndex(index, fingerprint);
+            if (tryRemove(index, fingerprint) || tryRemove(alt, fingerprint)) {
+                count--;
+                if (victim.used) { // Now there is room for it
+                    Victim last = victim;
+                    victim.used = false;
+                    if (!tryPut(last.index, last.fingerprint) && !tryPut(altIndex(last.index, last.fingerprint), last.fingerprint)) {
+                        place(last.index, last.fingerprint);
+                    }
+                }
+                return true;
+            }
+            if (victim.used && victim.fingerprint == fingerprint && (victim.index == index || victim.index == alt)) {
+                victim.used = false;
+                count--;
+                return true;
+            }
+            return false;
+        }
+
+        // Whether the key may have been inserted, false means it was not or it was erased
+        bool mayContain(std::string_view key) const {
+            size_t index;
+            Fingerprint fingerprint;
+            locate(key, index, fingerprint);
+            size_t alt = altIndex(index, fingerprint);
+            if (victim.used && victim.fingerprint == fingerprint && (victim.index == index || victim.index == alt)) {
+                return true;
+            }
+            return probe(index, alt, fingerprint);
+        }
+
+        void clear() {
+            std::fill(buckets.begin(), buckets.end(), 0);
+            victim.used = false;
+            count = 0;
+        }
+        size_t size() const { // Get the number of keys in the filter
+            return count;
+        }
+        size_t capacity() const { // Get the number of slots
+            return buckets.size() * cuckoo::kSlots;
+        }
+        uint32_t fingerprintBits() const {
+            return bits;
+        }
+        size_t memoryUsage() const {
+            return buckets.size() * sizeof(Bucket);
+        }
+        // The buckets, of which the fingerprints of the keys are used
+        void reportMemory(MemoryReport& report, std::string_view name) const {
+            report.add(std::string(name), memoryUsage(), (count * bits + 7) / 8);
+        }
+    };
+
+    using CuckooFilter8 = BasicCuckooFilter<uint8_t>; // For a false positive rate down to about 3%
+    using CuckooFilter16 = BasicCuckooFilter<uint16_t>; // Down to about 0.012%
+}
+
+#endif // CUCKOOFILTER_HPP
@@ -2,20 +2,194 @@
 #define ORANGEKV_FILTERPOLICY_HPP
 #include <cstdint>
 #include <cstddef>
+#include <algorithm>
+#include <cstring>
 #include <list>
 #include <mutex>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <utility>
 #include <memory>
+#include <new>
+#include <span>
 #include <vector>   
 #include "utility/hash.hpp"
+
+// The layouts of filter data, stored in the trailer so a reader knows what it is looking at
+enum class FilterLayout : uint8_t {
+    kBloom = 0, // Bits scattered over the whole filter
+    kBlockedBloom = 1, // All bits of a key in one 64 byte line
+    kBinaryFuse8 = 2, // 8 bit fingerprints solved so three of them XOR to the key's
+    kSortedPrefixes = 3, // The shortest prefixes that tell the sorted keys apart
+    kPartitioned = 4, // Filters of key ranges with an index on top
+};
+
+/*
+ * Every filter ends with a trailer of kFilterTrailerBytes: the number of probes of a key and
+ * the layout. Filters are read with the probe count they were built with, so the bits per
+ * key of a policy can change without breaking the filters already written.
+ */
+constexpr size_t kFilterTrailerBytes = 2;
+
+struct FilterTrailer {
+    uint32_t probes;
+    FilterLayout layout;
+};
+
+inline void AppendFilterTrailer(std::string& dest, uint32_t probes, FilterLayout layout) {
+    dest.push_back(static_cast<char>(probes));
+    dest.push_back(static_cast<char>(layout));
+}
+
+// Get the trailer of a filter and the size of the data before it, false if it has none
+inline bool ReadFilterTrailer(std::string_view filter, FilterTrailer& trailer, size_t& dataSize) {
+    if (filter.size() < kFilterTrailerBytes) {
+        return false;
+    }
+    dataSize = filter.size() - kFilterTrailerBytes;
+    trailer.probes = static_cast<uint8_t>(filter[dataSize]);
+    trailer.layout = static_cast<FilterLayout>(filter[dataSize + 1]);
+    return true;
+}
+
+// Start loading the cache line of an address that a filter probe will read soon
+inline void PrefetchFilterLine(const void* address) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address, 0, 3);
+#else
+    (void)address;
+#endif
+}
+
+/*
+ * A copy of a filter in memory aligned to a cache line. A std::string is only as aligned as
+ * malloc, 16 bytes, so most 64 byte lines of a blocked Bloom filter held in one straddle two
+ * cache lines; held here, every line is one cache line. Probe it with
+ * FilterPolicy::keyMayMatchIn(key, filter.data()).
+ */
+class AlignedFilter {
+public:
+    static constexpr size_t kAlignment = 64;
+
+    AlignedFilter() = default;
+    explicit AlignedFilter(std::string_view filter) : bytes(allocate(filter.size())), size(filter.size()) {
+        if (size > 0) {
+            std::memcpy(bytes.get(), filter.data(), size);
+        }
+    }
+    AlignedFilter(AlignedFilter&& other) noexcept : bytes(std::move(other.bytes)), size(std::exchange(other.size, 0)) {}
+    AlignedFilter& operator=(AlignedFilter&& other) noexcept {
+        bytes = std::move(other.bytes);
+        size = std::exchange(other.size, 0);
+        return *this;
+    }
+    std::string_view data() const {
+        return std::string_view(bytes.get(), size);
+    }
+    size_t allocatedBytes() const { // Rounded up to whole lines
+        return (size + kAlignment - 1) / kAlignment * kAlignment;
+    }
+private:
+    struct Free {
+        void operator()(char* p) const {
+            ::operator delete(p, std::align_val_t(kAlignment));
+        }
+    };
+    static char* allocate(size_t size) {
+        size_t rounded = (size + kAlignment - 1) / kAlignment * kAlignment;
+        return rounded == 0 ? nullptr : static_cast<char*>(::operator new(rounded, std::align_val_t(kAlignment)));
+    }
+    std::unique_ptr<char[], Free> bytes;
+    size_t size = 0;
+};
+
+// Collects the hashes of the keys of a filter, a key added twice is counted once
+template<typename HashType>
+class FilterHashes {
+private:
+    std::vector<HashType> hashes;
+public:
+    void add(HashType hash) {
+        if (hashes.empty() || hashes.back() != hash) { // Sorted input repeats keys back to back
+            hashes.push_back(hash);
+        }
+    }
+    // Get the distinct hashes, which empties the collector
+    std::vector<HashType> take() {
+        std::sort(hashes.begin(), hashes.end());
+        hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+        return std::move(hashes);
+    }
+    size_t size() const {
+        return hashes.size();
+    }
+};
+
+// Builds one filter from a stream of keys
+class FilterBitsBuilder {
+public:
+    virtual ~FilterBitsBuilder() = default;
+    virtual void addKey(std::string_view key) = 0;
+    // The number of keys added so far, keys added more than once may be counted more than once
+    virtual size_t numAdded() const = 0;
+    // Append the filter of the keys added so far to dest, and start over
+    virtual void finish(std::string& dest) = 0;
+};
+
 class FilterPolicy {
 public:
     FilterPolicy() {}
-    virtual ~FilterPolicy();
+    virtual ~FilterPolicy() = default;
     virtual const std::string Name() const = 0;
-    virtual void createFilter(const std::string& keys, size_t n, std::string& dest) = 0;
-    virtual bool keyMayMatch(const std::string& key, const std::string& filter) = 0;
+    virtual std::unique_ptr<FilterBitsBuilder> newBuilder() const = 0;
+    // Append a filter that summarizes keys[0, n) to dest
+    virtual void createFilter(const std::string* keys, size_t n, std::string& dest) const {
+        std::unique_ptr<FilterBitsBuilder> builder = newBuilder();
+        for (size_t i = 0; i < n; i++) {
+            builder->addKey(keys[i]);
+        }
+        builder->finish(dest);
+    }
+    // False only if the key was not among the keys the filter was created from
+    virtual bool keyMayMatch(const std::string& key, const std::string& filter) const = 0;
+    /**
+     * keyMayMatch on a filter that is a piece of a larger buffer, such as a partition of a
+     * partitioned filter. The filters override it to probe the bytes in place, the default
+     * copies them into strings.
+     */
+    virtual bool keyMayMatchIn(std::string_view key, std::string_view filter) const {
+        return keyMayMatch(std::string(key), std::string(filter));
+    }
+    // False only if no key the filter was created from starts with prefix
+    virtual bool prefixMayMatch(std::string_view prefix, const std::string& filter) const {
+        (void)prefix;
+        (void)filter;
+        return true;
+    }
+    // False only if no key the filter was created from is in [lo, hi]
+    virtual bool rangeMayMatch(std::string_view lo, std::string_view hi, const std::string& filter) const {
+        (void)lo;
+        (void)hi;
+        (void)filter;
+        return true;
+    }
+    /**
+     * Checks many keys against one filter, mayMatch[i] is keyMayMatch(keys[i], filter). The
+     * filters override this to overlap the cache misses of all the keys instead of waiting
+     * for them one key at a time.
+     */
+    virtual void keysMayMatch(std::span<const std::string_view> keys, const std::string& filter, std::vector<bool>& mayMatch) const {
+        mayMatch.assign(keys.size(), false);
+        std::string key;
+        for (size_t i = 0; i < keys.size(); i++) {
+            key.assign(keys[i]);
+            mayMatch[i] = keyMayMatch(key, filter);
+        }
+    }
 };
-const FilterPolicy* NewBloomFilterPolicy(int bits_per_key);
-#endif 
\ No newline at end of file
+inline const FilterPolicy* NewBloomFilterPolicy(int bits_per_key);
+inline const FilterPolicy* NewBlockedBloomFilterPolicy(int bits_per_key);
+inline const FilterPolicy* NewBinaryFuseFilterPolicy();
+inline const FilterPolicy* NewRangeFilterPolicy(size_t suffix_bytes);
+#endif
@@ -0,0 +1,95 @@
+#ifndef HASHINDEX_HPP
+#define HASHINDEX_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <new>
+#include "utility/memory_pool.hpp"
+/*
+ * A hash index that entries are only ever added to, from any number of threads at once. The
+ * bucket array and the nodes live in a memory pool, so there is nothing to free one by one.
+ * The number of buckets is fixed when the index is made, a power of two, and every bucket is a
+ * chain a new node is pushed onto with a compare and swap, newest first. Nodes keep the full
+ * hash of their entry, so a lookup only looks at entries whose hashes are equal.
+ *
+ * Readers need no lock: a node is fully built before the release that links it in. Size it to
+ * the entries expected, chains get longer past one entry per bucket, and versions of a key
+ * share a chain.
+ */
+namespace OrangeKV {
+    template<typename Entry, typename Pool = ConcurrentMemoryPool>
+    class HashIndex {
+    private:
+        struct Node {
+            Node(uint64_t hash, const Entry& entry) : hash(hash), entry(entry) {}
+            uint64_t const hash;
+            Entry const entry;
+            std::atomic<Node*> next{nullptr};
+        };
+
+        Pool* const pool;
+        size_t const mask;
+        std::atomic<Node*>* const buckets;
+        std::atomic<size_t> count{0};
+
+        static size_t roundUpToPowerOfTwo(size_t n) {
+            size_t power = 1;
+            while (power < n) {
+                power <<= 1;
+            }
+            return power;
+        }
+        std::atomic<Node*>* newBuckets(size_t bucketCount) {
+            auto* array = reinterpret_cast<std::atomic<Node*>*>(pool->allocateAligned(sizeof(std::atomic<Node*>) * bucketCount));
+            for (size_t i = 0; i < bucketCount; i++) {
+                new (&array[i]) std::atomic<Node*>(nullptr);
+            }
+            return array;
+        }
+    public:
+        // The pool must outlive the index
+        HashIndex(size_t bucketCount, Pool* pool)
+            : pool(pool), mask(roundUpToPowerOfTwo(bucketCount == 0 ? 1 : bucketCount) - 1), buckets(newBuckets(mask + 1)) {}
+        HashIndex(const HashIndex&) = delete;
+        HashIndex& operator=(const HashIndex&) = delete;
+
+        void insert(uint64_t hash, const Entry& entry) {
+            Node* node = new (pool->allocateAligned(sizeof(Node))) Node(hash, entry);
+            std::atomic<Node*>& bucket = buckets[hash & mask];
+            Node* head = bucket.load(std::memory_order_relaxed);
+            do {
+                node->next.store(head, std::memory_order_relaxed);
+            } while (!bucket.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed));
+            count.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // Call visit(entry) for every entry inserted with hash, newest first
+        template<typename Visitor>
+        void find(uint64_t hash, Visitor&& visit) const {
+            for (Node* node = buckets[hash & mask].load(std::memory_order_acquire); node != nullptr; node = node->next.load(std::memory_order_acquire)) {
+                if (node->hash == hash) {
+                    visit(node->entry);
+                }
+            }
+        }
+        // Call visit(entry) for every entry, in no order
+        template<typename Visitor>
+        void forEach(Visitor&& visit) const {
+            for (size_t i = 0; i <= mask; i++) {
+                for (Node* node = buckets[i].load(std::memory_order_acquire); node != nullptr; node = node->next.load(std::memory_order_acquire)) {
+                    visit(node->entry);
+                }
+            }
+        }
+
+        size_t size() const {
+            return count.load(std::memory_order_relaxed);
+        }
+        size_t bucketCount() const {
+            return mask + 1;
+        }
+    };
+}
+
+#endif // HASHINDEX_HPP
@@ -0,0 +1,112 @@
+#ifndef INTERNALKEY_HPP
+#define INTERNALKEY_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include "utility/coding.hpp"
+/*
+ * The keys the engine stores internally: the user key followed by an 8 byte tag, the
+ * sequence number of the write shifted left by 8 and or'ed with its type, as a fixed64.
+ * Internal keys sort by user key ascending and then by sequence number descending, so the
+ * newest version of a key comes first and a seek to (key, s) finds the newest version that
+ * is not newer than s.
+ */
+namespace OrangeKV {
+    using SequenceNumber = uint64_t;
+
+    // The top 8 bits of the tag are taken by the type
+    constexpr SequenceNumber kMaxSequenceNumber = (1ULL << 56) - 1;
+
+    enum class ValueType : uint8_t {
+        kDeletion = 0,
+        kValue = 1,
+    };
+    // The type that sorts first among entries of one sequence number, used to build seek keys
+    constexpr ValueType kValueTypeForSeek = ValueType::kValue;
+
+    constexpr size_t kTagBytes = 8;
+
+    inline uint64_t PackSequenceAndType(SequenceNumber sequence, ValueType type) {
+        return (sequence << 8) | static_cast<uint8_t>(type);
+    }
+
+    struct ParsedInternalKey {
+        std::string_view userKey;
+        SequenceNumber sequence;
+        ValueType type;
+    };
+
+    inline void AppendInternalKey(std::string& dest, std::string_view userKey, SequenceNumber sequence, ValueType type) {
+        dest.append(userKey.data(), userKey.size());
+        PutFixed64(dest, PackSequenceAndType(sequence, type));
+    }
+
+    inline std::string_view ExtractUserKey(std::string_view internalKey) {
+        return internalKey.substr(0, internalKey.size() - kTagBytes);
+    }
+
+    inline uint64_t ExtractTag(std::string_view internalKey) {
+        return DecodeFixed64(internalKey.data() + internalKey.size() - kTagBytes);
+    }
+
+    // false if the key is too short or has an unknown type
+    inline bool ParseInternalKey(std::string_view internalKey, ParsedInternalKey& result) {
+        if (internalKey.size() < kTagBytes) {
+            return false;
+        }
+        uint64_t tag = ExtractTag(internalKey);
+        uint8_t type = static_cast<uint8_t>(tag & 0xff);
+        if (type > static_cast<uint8_t>(ValueType::kValue)) {
+            return false;
+        }
+        result.userKey = ExtractUserKey(internalKey);
+        result.sequence = tag >> 8;
+        result.type = static_cast<ValueType>(type);
+        return true;
+    }
+
+    // Orders internal keys by user key bytewise, then by tag descending
+    struct InternalKeyComparator {
+        int operator()(std::string_view a, std::string_view b) const {
+            int r = ExtractUserKey(a).compare(ExtractUserKey(b));
+            if (r != 0) {
+                return r;
+            }
+            uint64_t tagA = ExtractTag(a);
+            uint64_t tagB = ExtractTag(b);
+            return tagA > tagB ? -1 : (tagA < tagB ? 1 : 0);
+        }
+    };
+
+    /**
+     * A key to look up in a memtable: the user key and the sequence number of the snapshot
+     * to read at, encoded as the internal key the memtable seeks to, with the length prefix
+     * the entries of a memtable have.
+     */
+    class LookupKey {
+    private:
+        std::string data; // varint32 length of the internal key, user key, tag
+        size_t keyStart;
+    public:
+        LookupKey(std::string_view userKey, SequenceNumber sequence) {
+            size_t internalSize = userKey.size() + kTagBytes;
+            PutVarint32(data, static_cast<uint32_t>(internalSize));
+            keyStart = data.size();
+            AppendInternalKey(data, userKey, sequence, kValueTypeForSeek);
+        }
+        const char* memtableKey() const { // The key with its length prefix
+            return data.data();
+        }
+        std::string_view internalKey() const {
+            return std::string_view(data).substr(keyStart);
+        }
+        std::string_view userKey() const {
+            return std::string_view(data).substr(keyStart, data.size() - keyStart - kTagBytes);
+        }
+    };
+}
+
+#endif // INTERNALKEY_HPP
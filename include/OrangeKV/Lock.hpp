@@ -0,0 +1,257 @@
+#ifndef ORANGEKV_LOCK_HPP
+#define ORANGEKV_LOCK_HPP
+#include <cassert>
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <thread>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+/*
+ * Locks for the LockPolicy of OrangeKV::Cache. The critical sections of a cache are a few
+ * pointer updates long, so these locks spin instead of sleeping in the kernel like std::mutex.
+ * All of them are BasicLockable and work with std::lock_guard.
+ */
+namespace OrangeKV {
+    // Tell the CPU we are spinning, so it can save power and give the sibling hyperthread a turn
+    inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield" ::: "memory");
+#endif
+    }
+
+    // Spin a while, then give the CPU away in case the thread we wait for is not running
+    class SpinWait {
+    private:
+        static constexpr uint32_t kSpinsBeforeYield = 4096;
+        uint32_t spins = 0;
+    public:
+        void wait(uint32_t pauses = 1) {
+            if (spins < kSpinsBeforeYield) {
+                spins += pauses;
+                for (uint32_t i = 0; i < pauses; i++) {
+                    cpuRelax();
+                }
+            }
+            else {
+                std::this_thread::yield();
+            }
+        }
+    };
+
+    // A lock that does nothing, for caches that are only used by one thread
+    class NullLock {
+    public:
+        void lock() {}
+        bool try_lock() {
+            return true;
+        }
+        void unlock() {}
+        void lock_shared() {}
+        bool try_lock_shared() {
+            return true;
+        }
+        void unlock_shared() {}
+    };
+
+    // A test and test-and-set lock, waiting threads back off exponentially to keep the line quiet
+    class SpinLock {
+    private:
+        static constexpr uint32_t kMaxBackoff = 1024; // Pauses, then the thread yields
+        std::atomic<bool> locked{false};
+    public:
+        void lock() {
+            uint32_t backoff = 1;
+            while (true) {
+                if (!locked.exchange(true, std::memory_order_acquire)) {
+                    return;
+                }
+                while (locked.load(std::memory_order_relaxed)) {
+                    if (backoff <= kMaxBackoff) {
+                        for (uint32_t i = 0; i < backoff; i++) {
+                            cpuRelax();
+                        }
+                        backoff <<= 1;
+                    }
+                    else {
+                        std::this_thread::yield();
+                    }
+                }
+            }
+        }
+        bool try_lock() {
+            return !locked.load(std::memory_order_relaxed) && !locked.exchange(true, std::memory_order_acquire);
+        }
+        void unlock() {
+            locked.store(false, std::memory_order_release);
+        }
+    };
+
+    // A FIFO spin lock: threads take a ticket and are served in order, so none of them starves
+    class TicketLock {
+    private:
+        alignas(64) std::atomic<uint32_t> next{0};
+        alignas(64) std::atomic<uint32_t> serving{0};
+    public:
+        void lock() {
+            uint32_t ticket = next.fetch_add(1, std::memory_order_relaxed);
+            SpinWait spinWait;
+            while (true) {
+                uint32_t current = serving.load(std::memory_order_acquire);
+                if (current == ticket) {
+                    return;
+                }
+                spinWait.wait((ticket - current) * 32); // Wait longer the further back in line
+            }
+        }
+        bool try_lock() {
+            uint32_t current = serving.load(std::memory_order_relaxed);
+            uint32_t ticket = current;
+            return next.compare_exchange_strong(ticket, current + 1, std::memory_order_acquire, std::memory_order_relaxed);
+        }
+        void unlock() {
+            serving.store(serving.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+    };
+
+    /**
+     * A Mellor-Crummey Scott queue lock. Every waiter spins on a flag in its own queue node, so
+     * a handover touches one remote cache line instead of all waiters hammering the lock word.
+     * The queue nodes are kept per thread, kMaxNesting of them, so taking a lock allocates
+     * nothing; a thread that holds more MCS locks at once than that takes the node of every
+     * further lock from the heap. Locks must be released in the reverse order they were taken,
+     * as std::lock_guard does.
+     */
+    class MCSLock {
+    private:
+        static constexpr size_t kMaxNesting = 8;
+        struct alignas(64) QNode {
+            std::atomic<QNode*> next;
+            std::atomic<bool> locked;
+        };
+        struct ThreadNodes {
+            QNode nodes[kMaxNesting];
+            size_t depth = 0;
+        };
+        static ThreadNodes& threadNodes() {
+            thread_local ThreadNodes nodes;
+            return nodes;
+        }
+        // The node of the next lock the thread takes, from the heap past kMaxNesting
+        static QNode* pushNode() {
+            ThreadNodes& local = threadNodes();
+            QNode* node = local.depth < kMaxNesting ? &local.nodes[local.depth] : new QNode;
+            local.depth++;
+            return node;
+        }
+        // Give back the node of the last lock taken, once no other thread can touch it
+        static void popNode(QNode* node) {
+            ThreadNodes& local = threadNodes();
+            assert(local.depth > 0);
+            if (--local.depth >= kMaxNesting) {
+                delete node;
+            }
+        }
+        std::atomic<QNode*> tail{nullptr};
+        QNode* owner = nullptr; // The node of the holder, only touched by the holder
+    public:
+        void lock() {
+            QNode* node = pushNode();
+            node->next.store(nullptr, std::memory_order_relaxed);
+            node->locked.store(true, std::memory_order_relaxed);
+            QNode* prev = tail.exchange(node, std::memory_order_acq_rel);
+            if (prev != nullptr) {
+                prev->next.store(node, std::memory_order_release);
+                SpinWait spinWait;
+                while (node->locked.load(std::memory_order_acquire)) {
+                    spinWait.wait();
+                }
+            }
+            owner = node;
+        }
+        bool try_lock() {
+            QNode* node = pushNode();
+            node->next.store(nullptr, std::memory_order_relaxed);
+            QNode* expected = nullptr;
+            if (!tail.compare_exchange_strong(expected, node, std::memory_order_acquire, std::memory_order_relaxed)) {
+                popNode(node);
+                return false;
+            }
+            owner = node;
+            return true;
+        }
+        void unlock() {
+            QNode* node = owner;
+            QNode* successor = node->next.load(std::memory_order_acquire);
+            if (successor == nullptr) {
+                QNode* expected = node;
+                if (tail.compare_exchange_strong(expected, nullptr, std::memory_order_release, std::memory_order_relaxed)) {
+                    popNode(node);
+                    return;
+                }
+                SpinWait spinWait;
+                while ((successor = node->next.load(std::memory_order_acquire)) == nullptr) { // It is linking itself in
+                    spinWait.wait();
+                }
+            }
+            successor->locked.store(false, std::memory_order_release);
+            popNode(node);
+        }
+    };
+
+    /**
+     * A reader-writer spin lock. Readers share it through lock_shared, which the read only
+     * paths of a cache use through std::shared_lock. A waiting writer stops new readers from
+     * coming in, so a steady stream of lookUps can't starve inserts.
+     */
+    class SharedSpinLock {
+    private:
+        static constexpr uint32_t kWriter = 1;
+        static constexpr uint32_t kWriterPending = 2;
+        static constexpr uint32_t kReader = 4; // The readers are counted from this bit up
+        std::atomic<uint32_t> state{0};
+    public:
+        void lock() {
+            SpinWait spinWait;
+            while (true) {
+                uint32_t s = state.load(std::memory_order_relaxed);
+                if ((s & ~kWriterPending) == 0) {
+                    if (state.compare_exchange_weak(s, kWriter, std::memory_order_acquire, std::memory_order_relaxed)) {
+                        return;
+                    }
+                    continue;
+                }
+                if ((s & kWriterPending) == 0) {
+                    state.fetch_or(kWriterPending, std::memory_order_relaxed);
+                }
+                spinWait.wait();
+            }
+        }
+        bool try_lock() {
+            uint32_t s = state.load(std::memory_order_relaxed);
+            return (s & ~kWriterPending) == 0
+                && state.compare_exchange_strong(s, kWriter, std::memory_order_acquire, std::memory_order_relaxed);
+        }
+        void unlock() {
+            state.fetch_and(~kWriter, std::memory_order_release);
+        }
+        void lock_shared() {
+            SpinWait spinWait;
+            while (!try_lock_shared()) {
+                spinWait.wait();
+            }
+        }
+        bool try_lock_shared() {
+            uint32_t s = state.load(std::memory_order_relaxed);
+            return (s & (kWriter | kWriterPending)) == 0
+                && state.compare_exchange_weak(s, s + kReader, std::memory_order_acquire, std::memory_order_relaxed);
+        }
+        void unlock_shared() {
+            state.fetch_sub(kReader, std::memory_order_release);
+        }
+    };
+}
+#endif // ORANGEKV_LOCK_HPP
@@ -0,0 +1,302 @@
+#ifndef MEMTABLE_HPP
+#define MEMTABLE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "utility/coding.hpp"
+#include "utility/hash.hpp"
+#include "utility/memory_pool.hpp"
+#include "utility/memory_report.hpp"
+#include "include/OrangeKV/HashIndex.hpp"
+#include "include/OrangeKV/InternalKey.hpp"
+#include "include/OrangeKV/SkipList.hpp"
+/*
+ * The write buffer: every write goes into a skiplist of entries in a ConcurrentMemoryPool,
+ * until the memtable is big enough to be flushed. An entry is
+ *     varint32 length of the internal key
+ *     internal key (user key and tag)
+ *     varint32 length of the value
+ *     value
+ * in one piece of the pool, and the skiplist holds pointers to the entries, so an insert is
+ * one allocation. Deleting a key adds an entry of type kDeletion that hides older ones.
+ *
+ * Either one thread calls add at a time, or any number of threads call addConcurrently at
+ * once, which inserts with compare and swap; the two may not run at the same time. Every
+ * thread keeps a splice per memtable, the nodes around its last insert, so a thread that
+ * writes ascending keys finds the place of the next one without searching from the top.
+ * get and the iterators need no lock and can run alongside either.
+ *
+ * A memtable made with MemTableRep::kHashIndex keeps its entries in a HashIndex by user key
+ * instead, for workloads that only get: a get hashes the key once and compares it with the
+ * entries of one bucket, not with log n keys on the way down a skiplist. Nothing is ordered
+ * until an iterator is positioned, which sorts the entries there and then, as a flush does
+ * once.
+ */
+namespace OrangeKV {
+    // The internal key of an entry that starts with its varint32 length
+    inline std::string_view GetLengthPrefixedKey(const char* entry) {
+        uint32_t length = 0;
+        const char* p = GetVarint32(entry, entry + 5, &length); // A varint32 is at most 5 bytes
+        return std::string_view(p, length);
+    }
+
+    // Orders the entries of a memtable by their internal keys
+    struct MemTableKeyComparator {
+        InternalKeyComparator comparator;
+        int operator()(const char* a, const char* b) const {
+            return comparator(GetLengthPrefixedKey(a), GetLengthPrefixedKey(b));
+        }
+    };
+
+    // How a memtable finds its entries
+    enum class MemTableRep {
+        kSkipList, // Ordered as they are added, for gets and scans
+        kHashIndex, // Hashed by user key, for gets only, ordered at flush
+    };
+
+    class MemTable {
+    private:
+        using Table = SkipList<const char*, MemTableKeyComparator, ConcurrentMemoryPool>;
+        using Index = HashIndex<const char*, ConcurrentMemoryPool>;
+    public:
+        static constexpr size_t kDefaultHashBuckets = 1 << 16;
+
+        // hashBuckets is only used by kHashIndex and should be about the entries expected
+        explicit MemTable(MemTableRep rep = MemTableRep::kSkipList, size_t hashBuckets = kDefaultHashBuckets)
+            : rep_(rep), table(MemTableKeyComparator{}, &pool), id(nextId()) {
+            if (rep == MemTableRep::kHashIndex) {
+                index = new (pool.allocateAligned(sizeof(Index))) Index(hashBuckets, &pool);
+            }
+        }
+        MemTable(const MemTable&) = delete;
+        MemTable& operator=(const MemTable&) = delete;
+
+        // Add a value of a key, or a deletion of it with type kDeletion and an empty value
+        void add(SequenceNumber sequence, ValueType type, std::string_view key, std::string_view value) {
+            if (index != nullptr) {
+                index->insert(WyHash64(key), encodeEntry(sequence, type, key, value));
+                return;
+            }
+            table.insert(encodeEntry(sequence, type, key, value));
+        }
+        // add from any number of threads at once, a thread's ascending keys insert fastest
+        void addConcurrently(SequenceNumber sequence, ValueType type, std::string_view key, std::string_view value) {
+            if (index != nullptr) { // The index takes concurrent inserts as they are
+                index->insert(WyHash64(key), encodeEntry(sequence, type, key, value));
+                return;
+            }
+            table.insertConcurrently(encodeEntry(sequence, type, key, value), threadSplice());
+        }
+
+        /**
+         * @brief Finds the newest version of a key as of the sequence number of the lookUp key.
+         *
+         * @param value Set to the value if the version is a value.
+         * @param deleted Set to whether the version is a deletion.
+         * @return false if the memtable has no version of the key at that sequence number.
+         */
+        bool get(const LookupKey& key, std::string& value, bool& deleted) const {
+            if (index != nullptr) {
+                return getFromIndex(key, value, deleted);
+            }
+            Table::Iterator it(&table);
+            it.seek(key.memtableKey());
+            if (!it.valid()) {
+                return false;
+            }
+            std::string_view internalKey = GetLengthPrefixedKey(it.key());
+            if (ExtractUserKey(internalKey) != key.userKey()) {
+                return false;
+            }
+            readEntry(internalKey, value, deleted);
+            return true;
+        }
+
+        /**
+         * Walks the entries in internal key order. Over a kHashIndex memtable the first seek
+         * sorts the entries added so far and the iterator walks that copy, later adds are not
+         * seen.
+         */
+        class Iterator {
+        private:
+            const MemTable* memtable;
+            Table::Iterator it;
+            std::vector<const char*> sorted; // The entries of a hash index, once sorted
+            bool isSorted = false;
+            size_t position = 0; // Into sorted, sorted.size() when not valid
+            std::string seekKey; // The length prefixed target of seek, which must stay alive while comparing
+
+            void sort() {
+                if (isSorted) {
+                    return;
+                }
+                sorted.reserve(memtable->index->size());
+                memtable->index->forEach([this](const char* entry) {
+                    sorted.push_back(entry);
+                });
+                MemTableKeyComparator compare;
+                std::sort(sorted.begin(), sorted.end(), [&compare](const char* a, const char* b) {
+                    return compare(a, b) < 0;
+                });
+                isSorted = true;
+                position = sorted.size();
+            }
+            bool hashed() const {
+                return memtable->index != nullptr;
+            }
+            const char* entry() const {
+                return hashed() ? sorted[position] : it.key();
+            }
+        public:
+            explicit Iterator(const MemTable* memtable) : memtable(memtable), it(&memtable->table) {}
+            bool valid() const {
+                return hashed() ? position < sorted.size() : it.valid();
+            }
+            void seekToFirst() {
+                if (hashed()) {
+                    sort();
+                    position = 0;
+                    return;
+                }
+                it.seekToFirst();
+            }
+            void seekToLast() {
+                if (hashed()) {
+                    sort();
+                    position = sorted.empty() ? 0 : sorted.size() - 1;
+                    return;
+                }
+                it.seekToLast();
+            }
+            // Move to the first entry whose internal key is >= target
+            void seek(std::string_view internalKey) {
+                seekKey.clear();
+                PutLengthPrefixed(seekKey, internalKey);
+                if (hashed()) {
+                    sort();
+                    MemTableKeyComparator compare;
+                    auto found = std::lower_bound(sorted.begin(), sorted.end(), seekKey.data(), [&compare](const char* a, const char* b) {
+                        return compare(a, b) < 0;
+                    });
+                    position = found - sorted.begin();
+                    return;
+                }
+                it.seek(seekKey.data());
+            }
+            void next() {
+                if (hashed()) {
+                    position++;
+                    return;
+                }
+                it.next();
+            }
+            void prev() {
+                if (hashed()) {
+                    position = position == 0 ? sorted.size() : position - 1;
+                    return;
+                }
+                it.prev();
+            }
+            std::string_view key() const { // The internal key
+                return GetLengthPrefixedKey(entry());
+            }
+            std::string_view value() const {
+                return entryValue(key());
+            }
+        };
+
+        MemTableRep rep() const {
+            return rep_;
+        }
+        // Get the memory of the memtable, safe to call while another thread adds
+        size_t approximateMemoryUsage() const {
+            return pool.memoryUsage();
+        }
+        void reportMemory(MemoryReport& report, std::string_view name) const {
+            pool.reportMemory(report, name);
+        }
+    private:
+        const char* encodeEntry(SequenceNumber sequence, ValueType type, std::string_view key, std::string_view value) {
+            size_t internalSize = key.size() + kTagBytes;
+            size_t entrySize = VarintLength(internalSize) + internalSize + VarintLength(value.size()) + value.size();
+            char* entry = pool.allocate(entrySize);
+            char* p = EncodeVarint64(entry, internalSize);
+            std::memcpy(p, key.data(), key.size());
+            p += key.size();
+            uint64_t tag = PackSequenceAndType(sequence, type);
+            for (size_t i = 0; i < kTagBytes; i++) { // Fixed64, little endian
+                *p++ = static_cast<char>(tag >> (8 * i));
+            }
+            p = EncodeVarint64(p, value.size());
+            std::memcpy(p, value.data(), value.size());
+            return entry;
+        }
+        // The splice of the calling thread for this memtable. A thread keeps the splice of the
+        // last memtable it added to concurrently, told apart by id, which unlike the address is
+        // never reused
+        Table::Splice* threadSplice() {
+            struct ThreadSplice {
+                uint64_t owner = 0;
+                Table::Splice splice;
+            };
+            thread_local ThreadSplice current;
+            if (current.owner != id) {
+                current.owner = id;
+                current.splice = Table::Splice{};
+            }
+            return &current.splice;
+        }
+        static uint64_t nextId() {
+            static std::atomic<uint64_t> ids{0};
+            return ids.fetch_add(1, std::memory_order_relaxed) + 1;
+        }
+        // The newest entry of the key's bucket with its user key and a sequence number no newer
+        // than its snapshot. The newest is not always first when adds were concurrent
+        bool getFromIndex(const LookupKey& key, std::string& value, bool& deleted) const {
+            std::string_view userKey = key.userKey();
+            uint64_t snapshotTag = ExtractTag(key.internalKey());
+            std::string_view best;
+            uint64_t bestTag = 0;
+            index->find(WyHash64(userKey), [&](const char* entry) {
+                std::string_view internalKey = GetLengthPrefixedKey(entry);
+                uint64_t tag = ExtractTag(internalKey);
+                if (tag <= snapshotTag && (best.data() == nullptr || tag > bestTag) && ExtractUserKey(internalKey) == userKey) {
+                    best = internalKey;
+                    bestTag = tag;
+                }
+            });
+            if (best.data() == nullptr) {
+                return false;
+            }
+            readEntry(best, value, deleted);
+            return true;
+        }
+        static void readEntry(std::string_view internalKey, std::string& value, bool& deleted) {
+            deleted = static_cast<ValueType>(ExtractTag(internalKey) & 0xff) == ValueType::kDeletion;
+            if (!deleted) {
+                value.assign(entryValue(internalKey));
+            }
+        }
+        // The value stored after an internal key that points into an entry
+        static std::string_view entryValue(std::string_view internalKey) {
+            const char* p = internalKey.data() + internalKey.size();
+            uint32_t length = 0;
+            p = GetVarint32(p, p + 5, &length);
+            return std::string_view(p, length);
+        }
+
+        MemTableRep const rep_;
+        ConcurrentMemoryPool pool;
+        Table table; // Empty with a hash index
+        Index* index = nullptr; // In the pool, only with kHashIndex
+        uint64_t const id;
+    };
+}
+
+#endif // MEMTABLE_HPP
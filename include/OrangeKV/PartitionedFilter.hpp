@@ -0,0 +1,341 @@
+#ifndef PARTITIONEDFILTER_HPP
+#define PARTITIONEDFILTER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "utility/coding.hpp"
+#include "utility/memory_report.hpp"
+#include "include/OrangeKV/Cache.hpp"
+#include "include/OrangeKV/FilterPolicy.hpp"
+/*
+ * A filter split by key range into partitions of the inner policy, with a small index on
+ * top, so a lookUp needs the index and the one partition that covers the key instead of the
+ * whole filter. The keys must be added in sorted order.
+ *
+ * The filter is the partitions, then the index, then the footer: the number of partitions
+ * (fixed32), the offset of the index (fixed64) and the filter trailer. The index has one
+ * entry per partition, the length prefixed separator (every key of the partition is <= it
+ * and every key of the next partition is > it), the varint offset and the varint size of the
+ * partition, followed by the offsets of the entries from the start of the index (fixed32
+ * each) for binary search.
+ */
+namespace OrangeKV {
+    namespace partition {
+        constexpr size_t kFooterBytes = 12;
+
+        // A short string s with last <= s < next, to keep the separators of the index small
+        inline std::string shortSeparator(std::string_view last, std::string_view next) {
+            size_t shared = 0;
+            size_t n = std::min(last.size(), next.size());
+            while (shared < n && last[shared] == next[shared]) {
+                shared++;
+            }
+            if (shared < n) {
+                uint8_t byte = static_cast<uint8_t>(last[shared]);
+                if (byte < 0xff && byte + 1 < static_cast<uint8_t>(next[shared])) {
+                    std::string separator(last.substr(0, shared + 1));
+                    separator[shared] = static_cast<char>(byte + 1);
+                    return separator;
+                }
+            }
+            return std::string(last);
+        }
+
+        struct IndexEntry {
+            std::string_view separator;
+            uint64_t offset;
+            uint32_t size;
+        };
+
+        // The index and footer of a filter, which has to outlive it
+        class Index {
+        private:
+            const char* index = nullptr;
+            size_t indexSize = 0;
+            const char* offsets = nullptr;
+            uint32_t count = 0;
+        public:
+            /**
+             * @brief Parses the tail of a filter.
+             *
+             * @param tail The bytes from the index to the end of the filter.
+             * @return false if the tail is malformed.
+             */
+            bool open(std::string_view tail) {
+                FilterTrailer trailer;
+                size_t bytes;
+                if (!ReadFilterTrailer(tail, trailer, bytes) || trailer.layout != FilterLayout::kPartitioned || bytes < kFooterBytes) {
+                    return false;
+                }
+                count = DecodeFixed32(tail.data() + bytes - kFooterBytes);
+                if (count > (bytes - kFooterBytes) / 4) {
+                    return false;
+                }
+                index = tail.data();
+                indexSize = bytes - kFooterBytes - count * 4;
+                offsets = index + indexSize;
+                return true;
+            }
+            uint32_t size() const {
+                return count;
+            }
+            // Decode the separator of entry i, input is left at the rest of the entry
+            bool separator(uint32_t i, std::string_view& out, std::string_view& input) const {
+                uint32_t offset = DecodeFixed32(offsets + i * 4);
+                if (offset > indexSize) {
+                    return false;
+                }
+                input = std::string_view(index + offset, indexSize - offset);
+                return GetLengthPrefixed(input, out);
+            }
+            bool entry(uint32_t i, IndexEntry& out) const {
+                std::string_view input;
+                uint64_t partitionSize;
+                const char* p;
+                if (!separator(i, out.separator, input)
+                    || (p = GetVarint64(input.data(), input.data() + input.size(), &out.offset)) == nullptr
+                    || GetVarint64(p, input.data() + input.size(), &partitionSize) == nullptr || partitionSize > UINT32_MAX) {
+                    return false;
+                }
+                out.size = static_cast<uint32_t>(partitionSize);
+                return true;
+            }
+
+            /**
+             * @brief Finds the partition that covers a key.
+             *
+             * @return 1 if found, 0 if the key is past every partition, -1 if the index is corrupt.
+             */
+            int find(std::string_view key, IndexEntry& out) const {
+                uint32_t left = 0;
+                uint32_t right = count;
+                std::string_view separator;
+                std::string_view rest;
+                while (left < right) { // The first separator >= key, only the separators are decoded on the way
+                    uint32_t mid = left + (right - left) / 2;
+                    if (!this->separator(mid, separator, rest)) {
+                        return -1;
+                    }
+                    if (separator < key) {
+                        left = mid + 1;
+                    }
+                    else {
+                        right = mid;
+                    }
+                }
+                if (left == count) {
+                    return 0;
+                }
+                return entry(left, out) ? 1 : -1;
+            }
+        };
+
+        // Read the footer at the end of a filter of filterSize bytes, the footer and trailer are the last kTailBytes
+        constexpr size_t kTailBytes = kFooterBytes + kFilterTrailerBytes;
+        inline bool indexOffset(std::string_view tail, uint64_t filterSize, uint64_t& offset) {
+            if (tail.size() < kTailBytes) {
+                return false;
+            }
+            offset = DecodeFixed64(tail.data() + tail.size() - kFilterTrailerBytes - 8);
+            return offset <= filterSize - kTailBytes;
+        }
+    }
+
+    class PartitionedFilterBuilder : public FilterBitsBuilder {
+    private:
+        std::shared_ptr<const FilterPolicy> inner;
+        size_t keysPerPartition;
+        std::unique_ptr<FilterBitsBuilder> current;
+        size_t keysInPartition = 0;
+        std::string lastKey;
+        std::string partitions; // The finished partitions
+        std::string index;
+        std::vector<uint32_t> entryOffsets;
+        size_t added = 0;
+
+        void cutPartition(std::string_view separator) {
+            size_t offset = partitions.size();
+            current->finish(partitions);
+            entryOffsets.push_back(static_cast<uint32_t>(index.size()));
+            PutLengthPrefixed(index, separator);
+            PutVarint64(index, offset);
+            PutVarint64(index, partitions.size() - offset);
+            keysInPartition = 0;
+        }
+    public:
+        PartitionedFilterBuilder(std::shared_ptr<const FilterPolicy> inner, size_t keysPerPartition)
+            : inner(std::move(inner)), keysPerPartition(std::max<size_t>(keysPerPartition, 1)) {
+            current = this->inner->newBuilder();
+        }
+        void addKey(std::string_view key) override {
+            if (keysInPartition >= keysPerPartition && key != lastKey) { // Equal keys stay in one partition
+                cutPartition(partition::shortSeparator(lastKey, key));
+            }
+            current->addKey(key);
+            lastKey.assign(key);
+            keysInPartition++;
+            added++;
+        }
+        size_t numAdded() const override {
+            return added;
+        }
+        void finish(std::string& dest) override {
+            if (keysInPartition > 0) {
+                cutPartition(lastKey);
+            }
+            uint64_t indexOffset = partitions.size(); // From the start of the filter, like the partition offsets
+            dest.append(partitions);
+            dest.append(index);
+            for (uint32_t offset : entryOffsets) {
+                PutFixed32(dest, offset);
+            }
+            PutFixed32(dest, static_cast<uint32_t>(entryOffsets.size()));
+            PutFixed64(dest, indexOffset);
+            AppendFilterTrailer(dest, 0, FilterLayout::kPartitioned);
+            partitions.clear();
+            index.clear();
+            entryOffsets.clear();
+            lastKey.clear();
+            added = 0;
+        }
+    };
+
+    /**
+     * A FilterPolicy over a partitioned filter that is in memory as a whole. The partition
+     * offsets in the index are from the start of the filter, so filters must be passed to
+     * createFilter with an empty dest or be cut out of it at the offset they started at.
+     */
+    class PartitionedFilter : public FilterPolicy {
+    private:
+        std::shared_ptr<const FilterPolicy> inner;
+        size_t keysPerPartition;
+    public:
+        PartitionedFilter(std::shared_ptr<const FilterPolicy> inner, size_t keysPerPartition)
+            : inner(std::move(inner)), keysPerPartition(keysPerPartition) {}
+        const std::string Name() const override {
+            return "OrangeKV.PartitionedFilter:" + inner->Name();
+        }
+        std::unique_ptr<FilterBitsBuilder> newBuilder() const override {
+            return std::make_unique<PartitionedFilterBuilder>(inner, keysPerPartition);
+        }
+        bool keyMayMatch(const std::string& key, const std::string& filter) const override {
+            return keyMayMatchIn(key, filter);
+        }
+        // The partition is probed where it is, without copying it
+        bool keyMayMatchIn(std::string_view key, std::string_view filter) const override {
+            uint64_t offset;
+            partition::Index index;
+            if (!partition::indexOffset(filter, filter.size(), offset) || !index.open(filter.substr(offset))) {
+                return true;
+            }
+            partition::IndexEntry entry;
+            int found = index.find(key, entry);
+            if (found <= 0) {
+                return found < 0;
+            }
+            if (entry.offset + entry.size > offset) {
+                return true;
+            }
+            return inner->keyMayMatchIn(key, filter.substr(entry.offset, entry.size));
+        }
+        const FilterPolicy& innerPolicy() const {
+            return *inner;
+        }
+    };
+
+    /**
+     * Reads a partitioned filter that is not in memory. Only the index is pinned; a partition
+     * is read through the fetcher the first time a key falls into it and kept in an LRU cache
+     * of partitions, so the memory held for the filter is the index plus the cache capacity.
+     * Cached partitions are AlignedFilters, so the lines of a blocked Bloom partition are
+     * cache lines.
+     */
+    class PartitionedFilterReader {
+    public:
+        // Reads size bytes of the filter at offset into out, false on error
+        using Fetcher = std::function<bool(uint64_t offset, size_t size, std::string& out)>;
+    private:
+        using PartitionCache = Cache<uint64_t, AlignedFilter, LRUPolicy, std::mutex, std::hash<uint64_t>>;
+        std::shared_ptr<const FilterPolicy> inner;
+        Fetcher fetcher;
+        std::string tail; // The index and footer
+        partition::Index index;
+        PartitionCache cache;
+        std::atomic<uint64_t> fetches{0};
+        bool opened = false;
+    public:
+        PartitionedFilterReader(std::shared_ptr<const FilterPolicy> inner, Fetcher fetcher, size_t cacheCapacity)
+            : inner(std::move(inner)), fetcher(std::move(fetcher)) {
+            cache.setCapacity(cacheCapacity);
+        }
+
+        // Read the index of a filter of filterSize bytes, false if it can't be read
+        bool open(uint64_t filterSize) {
+            std::string footer;
+            uint64_t offset;
+            if (filterSize < partition::kTailBytes || !fetcher(filterSize - partition::kTailBytes, partition::kTailBytes, footer)
+                || !partition::indexOffset(footer, filterSize, offset) || !fetcher(offset, filterSize - offset, tail)) {
+                return false;
+            }
+            opened = index.open(tail);
+            return opened;
+        }
+
+        bool keyMayMatch(const std::string& key) {
+            if (!opened) {
+                return true;
+            }
+            partition::IndexEntry entry;
+            int found = index.find(key, entry);
+            if (found <= 0) {
+                return found < 0;
+            }
+            uint32_t hash = static_cast<uint32_t>(std::hash<uint64_t>()(entry.offset));
+            Handle* handle = cache.lookUp(entry.offset, hash);
+            if (handle == nullptr) {
+                std::string data;
+                fetches.fetch_add(1, std::memory_order_relaxed);
+                if (!fetcher(entry.offset, entry.size, data)) {
+                    return true;
+                }
+                auto* partition = new AlignedFilter(data);
+                size_t charge = partition->allocatedBytes();
+                handle = cache.insert(entry.offset, hash, partition, charge, [](const uint64_t&, AlignedFilter* value) { delete value; });
+            }
+            bool mayMatch = inner->keyMayMatchIn(key, cache.value(handle)->data());
+            cache.release(handle);
+            return mayMatch;
+        }
+
+        size_t pinnedBytes() const { // Get the memory held by the index
+            return tail.capacity();
+        }
+        size_t cachedBytes() const { // Get the memory held by cached partitions
+            return cache.totalCharge();
+        }
+        uint64_t partitionFetches() const { // Get the number of partitions read through the fetcher
+            return fetches.load(std::memory_order_relaxed);
+        }
+        // The pinned index and the cached partitions
+        void reportMemory(MemoryReport& report, std::string_view name) const {
+            size_t cached = cache.totalCharge();
+            report.add(std::string(name) + ".index", tail.capacity() + 1, tail.size());
+            report.add(std::string(name) + ".partitions", cached, cached);
+        }
+    };
+}
+
+// Takes ownership of inner, which builds the filter of every partition
+inline const FilterPolicy* NewPartitionedFilterPolicy(const FilterPolicy* inner, size_t keys_per_partition) {
+    return new OrangeKV::PartitionedFilter(std::shared_ptr<const FilterPolicy>(inner), keys_per_partition);
+}
+
+#endif // PARTITIONEDFILTER_HPP
@@ -0,0 +1,167 @@
+#ifndef PREFIXFILTER_HPP
+#define PREFIXFILTER_HPP
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <span>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "include/OrangeKV/FilterPolicy.hpp"
+#include "include/OrangeKV/BlockedBloomFilter.hpp"
+namespace OrangeKV {
+    // Maps a key to the prefix that prefix filters index it by
+    class PrefixExtractor {
+    public:
+        virtual ~PrefixExtractor() = default;
+        virtual const std::string Name() const = 0;
+        // Whether the key has a prefix at all, keys outside the domain are not indexed
+        virtual bool inDomain(std::string_view key) const = 0;
+        // The prefix of a key in the domain, a prefix of the key itself
+        virtual std::string_view transform(std::string_view key) const = 0;
+        // Whether every key that starts with prefix has the same transform as prefix
+        virtual bool fixesTransform(std::string_view prefix) const = 0;
+    };
+
+    // The first n bytes, keys shorter than n have no prefix
+    class FixedPrefixExtractor : public PrefixExtractor {
+    private:
+        size_t n;
+    public:
+        explicit FixedPrefixExtractor(size_t n) : n(n) {}
+        const std::string Name() const override {
+            return "OrangeKV.FixedPrefix." + std::to_string(n);
+        }
+        bool inDomain(std::string_view key) const override {
+            return key.size() >= n;
+        }
+        std::string_view transform(std::string_view key) const override {
+            return key.substr(0, n);
+        }
+        bool fixesTransform(std::string_view prefix) const override {
+            return prefix.size() >= n;
+        }
+    };
+
+    // The first n bytes, or the whole key if it is shorter
+    class CappedPrefixExtractor : public PrefixExtractor {
+    private:
+        size_t n;
+    public:
+        explicit CappedPrefixExtractor(size_t n) : n(n) {}
+        const std::string Name() const override {
+            return "OrangeKV.CappedPrefix." + std::to_string(n);
+        }
+        bool inDomain(std::string_view) const override {
+            return true;
+        }
+        std::string_view transform(std::string_view key) const override {
+            return key.substr(0, n);
+        }
+        bool fixesTransform(std::string_view prefix) const override {
+            return prefix.size() >= n;
+        }
+    };
+
+    class PrefixBloomFilterBuilder : public FilterBitsBuilder {
+    private:
+        std::shared_ptr<const PrefixExtractor> extractor;
+        std::unique_ptr<FilterBitsBuilder> inner;
+        bool wholeKeyFiltering;
+        std::string lastPrefix; // Sorted keys share prefixes back to back
+        bool hasLastPrefix = false;
+        size_t added = 0;
+    public:
+        PrefixBloomFilterBuilder(std::shared_ptr<const PrefixExtractor> extractor, std::unique_ptr<FilterBitsBuilder> inner, bool wholeKeyFiltering)
+            : extractor(std::move(extractor)), inner(std::move(inner)), wholeKeyFiltering(wholeKeyFiltering) {}
+        void addKey(std::string_view key) override {
+            added++;
+            if (wholeKeyFiltering) {
+                inner->addKey(key);
+            }
+            if (extractor->inDomain(key)) {
+                std::string_view prefix = extractor->transform(key);
+                if (!hasLastPrefix || prefix != lastPrefix) {
+                    inner->addKey(prefix);
+                    lastPrefix.assign(prefix);
+                    hasLastPrefix = true;
+                }
+            }
+        }
+        size_t numAdded() const override {
+            return added;
+        }
+        void finish(std::string& dest) override {
+            inner->finish(dest);
+            hasLastPrefix = false;
+            added = 0;
+        }
+    };
+
+    /**
+     * A filter that indexes the prefix of every key as well as the key, so a scan over a
+     * prefix can skip the data the filter rules out. The prefixes and the keys go into one
+     * filter of the inner policy, which a key that equals some prefix can only make answer
+     * true more often. Without whole key filtering only the prefixes are indexed, and point
+     * lookUps test the prefix of the key.
+     */
+    class PrefixBloomFilter : public FilterPolicy {
+    private:
+        std::shared_ptr<const PrefixExtractor> extractor;
+        std::shared_ptr<const FilterPolicy> inner;
+        bool wholeKeyFiltering;
+    public:
+        PrefixBloomFilter(std::shared_ptr<const PrefixExtractor> extractor, std::shared_ptr<const FilterPolicy> inner, bool wholeKeyFiltering)
+            : extractor(std::move(extractor)), inner(std::move(inner)), wholeKeyFiltering(wholeKeyFiltering) {}
+        const std::string Name() const override {
+            return "OrangeKV.PrefixFilter:" + extractor->Name() + ":" + inner->Name();
+        }
+        std::unique_ptr<FilterBitsBuilder> newBuilder() const override {
+            return std::make_unique<PrefixBloomFilterBuilder>(extractor, inner->newBuilder(), wholeKeyFiltering);
+        }
+        bool keyMayMatch(const std::string& key, const std::string& filter) const override {
+            return keyMayMatchIn(key, filter);
+        }
+        bool keyMayMatchIn(std::string_view key, std::string_view filter) const override {
+            if (wholeKeyFiltering) {
+                return inner->keyMayMatchIn(key, filter);
+            }
+            if (!extractor->inDomain(key)) {
+                return true;
+            }
+            return inner->keyMayMatchIn(extractor->transform(key), filter);
+        }
+        void keysMayMatch(std::span<const std::string_view> keys, const std::string& filter, std::vector<bool>& mayMatch) const override {
+            if (wholeKeyFiltering) {
+                inner->keysMayMatch(keys, filter, mayMatch);
+            }
+            else {
+                FilterPolicy::keysMayMatch(keys, filter, mayMatch);
+            }
+        }
+        // Only a prefix that decides the transform of the keys under it can be checked
+        bool prefixMayMatch(std::string_view prefix, const std::string& filter) const override {
+            if (!extractor->inDomain(prefix) || !extractor->fixesTransform(prefix)) {
+                return true;
+            }
+            return inner->keyMayMatchIn(extractor->transform(prefix), filter);
+        }
+        // A range within one extracted prefix is a prefix query
+        bool rangeMayMatch(std::string_view lo, std::string_view hi, const std::string& filter) const override {
+            if (!extractor->inDomain(lo) || !extractor->inDomain(hi) || !extractor->fixesTransform(lo)
+                || extractor->transform(lo) != extractor->transform(hi)) {
+                return true;
+            }
+            return prefixMayMatch(extractor->transform(lo), filter);
+        }
+    };
+}
+
+// Takes ownership of extractor, the keys and prefixes go into a BlockedBloomFilter
+inline const FilterPolicy* NewPrefixBloomFilterPolicy(const OrangeKV::PrefixExtractor* extractor, int bits_per_key, bool whole_key_filtering) {
+    return new OrangeKV::PrefixBloomFilter(std::shared_ptr<const OrangeKV::PrefixExtractor>(extractor),
+                                           std::make_shared<OrangeKV::BlockedBloomFilter>(bits_per_key), whole_key_filtering);
+}
+
+#endif // PREFIXFILTER_HPP
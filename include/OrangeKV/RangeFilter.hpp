@@ -0,0 +1,326 @@
+#ifndef RANGEFILTER_HPP
+#define RANGEFILTER_HPP
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "utility/coding.hpp"
+#include "include/OrangeKV/FilterPolicy.hpp"
+/*
+ * A range filter in the spirit of SuRF (Zhang et al., "SuRF: Practical Range Query Filtering
+ * with Fast Succinct Tries"). It keeps, for every key in sorted order, the shortest prefix
+ * that tells it apart from its neighbours plus suffixBytes more bytes of the key, and marks
+ * the prefixes that are whole keys. A stored prefix p stands for some key that starts with
+ * p, so a range [lo, hi] may hold a key only if the first prefix that can stand for a key
+ * >= lo is <= hi. The longer the suffix the fewer false positives, at the cost of space.
+ *
+ * Instead of a trie the prefixes are front coded against the previous one, with a restart
+ * point every kRestartInterval prefixes for binary search: each entry is varint shared,
+ * varint (unshared << 1 | whole key) and the unshared bytes. The entries are followed by
+ * the restart offsets and their count (fixed32 each) and the filter trailer.
+ */
+namespace OrangeKV {
+    namespace range {
+        constexpr size_t kRestartInterval = 16;
+
+        // A word at a time, the first differing byte of a word is found without a branch per byte
+        inline size_t sharedPrefix(std::string_view a, std::string_view b) {
+            size_t n = std::min(a.size(), b.size());
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                uint64_t x;
+                uint64_t y;
+                std::memcpy(&x, a.data() + i, 8);
+                std::memcpy(&y, b.data() + i, 8);
+                if (x != y) {
+                    int bits = std::endian::native == std::endian::little ? std::countr_zero(x ^ y) : std::countl_zero(x ^ y);
+                    return i + bits / 8;
+                }
+            }
+            while (i < n && a[i] == b[i]) {
+                i++;
+            }
+            return i;
+        }
+
+        // Whether every key a prefix can stand for is < target, given the bytes the two share
+        inline bool below(std::string_view prefix, bool wholeKey, std::string_view target, size_t matched) {
+            if (matched < prefix.size()) {
+                return matched < target.size() && static_cast<uint8_t>(prefix[matched]) < static_cast<uint8_t>(target[matched]);
+            }
+            return wholeKey && prefix.size() < target.size(); // A prefix of target, or target itself
+        }
+        inline bool below(std::string_view prefix, bool wholeKey, std::string_view target) {
+            return below(prefix, wholeKey, target, sharedPrefix(prefix, target));
+        }
+
+        /*
+         * Reads the prefixes of a filter in order. The current prefix is rebuilt in a buffer the
+         * caller owns, so a probe reuses its capacity rather than allocating. seek compares the
+         * prefixes where they are stored, the restart ones share nothing with the one before.
+         */
+        class Cursor {
+        private:
+            const char* data;
+            const char* limit; // The end of the entries
+            const char* restarts;
+            uint32_t numRestarts;
+            const char* next; // The entry after the current one
+            std::string& prefix;
+            bool wholeKey = false;
+            bool valid = false;
+
+            const char* restartEntry(uint32_t index) const {
+                uint32_t offset = DecodeFixed32(restarts + index * 4);
+                return offset <= static_cast<size_t>(limit - data) ? data + offset : limit;
+            }
+            // The prefix of a restart entry in place, false on a corrupt entry
+            bool restartKey(uint32_t index, std::string_view& key, bool& whole) const {
+                uint32_t shared;
+                uint32_t tagged;
+                const char* p = restartEntry(index);
+                if (p >= limit || (p = GetVarint32(p, limit, &shared)) == nullptr || (p = GetVarint32(p, limit, &tagged)) == nullptr) {
+                    return false;
+                }
+                uint32_t unshared = tagged >> 1;
+                if (shared != 0 || unshared > static_cast<size_t>(limit - p)) {
+                    return false;
+                }
+                key = std::string_view(p, unshared);
+                whole = (tagged & 1) != 0;
+                return true;
+            }
+        public:
+            Cursor(const char* data, size_t entriesSize, const char* restarts, uint32_t numRestarts, std::string& buffer)
+                : data(data), limit(data + entriesSize), restarts(restarts), numRestarts(numRestarts), next(data), prefix(buffer) {
+                prefix.clear();
+            }
+
+            bool isValid() const {
+                return valid;
+            }
+            std::string_view key() const {
+                return prefix;
+            }
+            bool isWholeKey() const {
+                return wholeKey;
+            }
+            // Decode the next entry, false at the end or on a corrupt entry
+            bool advance() {
+                uint32_t shared;
+                uint32_t tagged;
+                const char* p = next;
+                valid = false;
+                if (p >= limit || (p = GetVarint32(p, limit, &shared)) == nullptr || (p = GetVarint32(p, limit, &tagged)) == nullptr) {
+                    return false;
+                }
+                uint32_t unshared = tagged >> 1;
+                if (shared > prefix.size() || unshared > static_cast<size_t>(limit - p)) {
+                    return false;
+                }
+                prefix.resize(shared);
+                prefix.append(p, unshared);
+                wholeKey = (tagged & 1) != 0;
+                next = p + unshared;
+                valid = true;
+                return true;
+            }
+
+            /**
+             * @brief Moves to the first prefix that can stand for a key >= target.
+             *
+             * @return false if there is none.
+             */
+            bool seek(std::string_view target) {
+                uint32_t left = 0;
+                uint32_t right = numRestarts;
+                while (right - left > 1) { // The last restart that is below, or 0
+                    uint32_t mid = left + (right - left) / 2;
+                    std::string_view restart;
+                    bool whole;
+                    if (!restartKey(mid, restart, whole)) {
+                        valid = false;
+                        return false;
+                    }
+                    if (below(restart, whole, target)) {
+                        left = mid;
+                    }
+                    else {
+                        right = mid;
+                    }
+                }
+                return scanFrom(restartEntry(left), target);
+            }
+        private:
+            /*
+             * Walks the entries from a restart to the first prefix that is not below target and
+             * makes it the current one, comparing each prefix with target where it is stored.
+             * matched is how many bytes the prefix before shares with target. A prefix that
+             * shares more than that with the one before agrees with target up to the same byte
+             * and differs from it there the same way, so it is below too and isn't looked at.
+             * Any other shares its first bytes with target, so only the last one is copied.
+             */
+            bool scanFrom(const char* entry, std::string_view target) {
+                size_t length = 0; // Of the prefix before
+                size_t matched = 0;
+                valid = false;
+                while (true) {
+                    uint32_t shared;
+                    uint32_t tagged;
+                    const char* p = entry;
+                    if (p >= limit || (p = GetVarint32(p, limit, &shared)) == nullptr || (p = GetVarint32(p, limit, &tagged)) == nullptr) {
+                        return false;
+                    }
+                    uint32_t unshared = tagged >> 1;
+                    if (shared > length || unshared > static_cast<size_t>(limit - p)) {
+                        return false;
+                    }
+                    std::string_view rest(p, unshared);
+                    bool whole = (tagged & 1) != 0;
+                    entry = p + unshared;
+                    length = shared + unshared;
+                    if (shared > matched) {
+                        continue;
+                    }
+                    std::string_view targetRest = target.substr(shared);
+                    size_t restMatched = sharedPrefix(rest, targetRest);
+                    matched = shared + restMatched;
+                    if (!below(rest, whole, targetRest, restMatched)) {
+                        prefix.assign(target.data(), shared);
+                        prefix.append(rest);
+                        wholeKey = whole;
+                        next = entry;
+                        valid = true;
+                        return true;
+                    }
+                }
+            }
+        };
+    }
+
+    class RangeFilterBuilder : public FilterBitsBuilder {
+    private:
+        size_t suffixBytes;
+        std::vector<std::string> keys;
+    public:
+        explicit RangeFilterBuilder(size_t suffixBytes) : suffixBytes(suffixBytes) {}
+        void addKey(std::string_view key) override {
+            if (keys.empty() || keys.back() != key) {
+                keys.emplace_back(key);
+            }
+        }
+        size_t numAdded() const override {
+            return keys.size();
+        }
+        void finish(std::string& dest) override {
+            std::sort(keys.begin(), keys.end());
+            keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+            std::vector<uint32_t> restarts;
+            std::string last;
+            for (size_t i = 0; i < keys.size(); i++) {
+                size_t distinct = 0;
+                if (i > 0) {
+                    distinct = range::sharedPrefix(keys[i - 1], keys[i]);
+                }
+                if (i + 1 < keys.size()) {
+                    distinct = std::max(distinct, range::sharedPrefix(keys[i], keys[i + 1]));
+                }
+                size_t length = std::min(keys[i].size(), distinct + 1 + suffixBytes);
+                std::string_view prefix = std::string_view(keys[i]).substr(0, length);
+                size_t shared = 0;
+                if (i % range::kRestartInterval == 0) {
+                    restarts.push_back(static_cast<uint32_t>(dest.size()));
+                }
+                else {
+                    shared = range::sharedPrefix(last, prefix);
+                }
+                PutVarint32(dest, static_cast<uint32_t>(shared));
+                PutVarint32(dest, static_cast<uint32_t>((prefix.size() - shared) << 1 | (length == keys[i].size() ? 1 : 0)));
+                dest.append(prefix.data() + shared, prefix.size() - shared);
+                last.assign(prefix);
+            }
+            size_t start = restarts.empty() ? dest.size() : restarts.front();
+            for (uint32_t& offset : restarts) {
+                offset -= static_cast<uint32_t>(start); // Relative to the first entry
+            }
+            for (uint32_t offset : restarts) {
+                PutFixed32(dest, offset);
+            }
+            PutFixed32(dest, static_cast<uint32_t>(restarts.size()));
+            AppendFilterTrailer(dest, 0, FilterLayout::kSortedPrefixes);
+            keys.clear();
+        }
+    };
+
+    class RangeFilter : public FilterPolicy {
+    private:
+        size_t suffixBytes;
+    public:
+        explicit RangeFilter(size_t suffixBytes) : suffixBytes(suffixBytes) {}
+        const std::string Name() const override {
+            return "OrangeKV.RangeFilter";
+        }
+        std::unique_ptr<FilterBitsBuilder> newBuilder() const override {
+            return std::make_unique<RangeFilterBuilder>(suffixBytes);
+        }
+        bool keyMayMatch(const std::string& key, const std::string& filter) const override {
+            return keyMayMatchIn(key, filter);
+        }
+        bool keyMayMatchIn(std::string_view key, std::string_view filter) const override {
+            return withCursor(filter, [&](range::Cursor& cursor) {
+                return cursor.seek(key) && cursor.key() <= key;
+            });
+        }
+        bool prefixMayMatch(std::string_view prefix, const std::string& filter) const override {
+            return withCursor(filter, [&](range::Cursor& cursor) {
+                if (!cursor.seek(prefix)) {
+                    return false;
+                }
+                std::string_view p = cursor.key();
+                return p.substr(0, prefix.size()) == prefix || (!cursor.isWholeKey() && prefix.substr(0, p.size()) == p);
+            });
+        }
+        bool rangeMayMatch(std::string_view lo, std::string_view hi, const std::string& filter) const override {
+            if (hi < lo) {
+                return false;
+            }
+            return withCursor(filter, [&](range::Cursor& cursor) {
+                return cursor.seek(lo) && cursor.key() <= hi;
+            });
+        }
+    private:
+        // Calls fn with a cursor over the filter, true without calling it if the filter is unreadable.
+        // The cursor rebuilds prefixes in a buffer of the thread, which keeps its capacity
+        template<typename Fn>
+        static bool withCursor(std::string_view filter, Fn&& fn) {
+            FilterTrailer trailer;
+            size_t bytes;
+            if (!ReadFilterTrailer(filter, trailer, bytes) || trailer.layout != FilterLayout::kSortedPrefixes || bytes < 4) {
+                return true;
+            }
+            uint32_t numRestarts = DecodeFixed32(filter.data() + bytes - 4);
+            if (numRestarts > (bytes - 4) / 4) {
+                return true;
+            }
+            size_t entriesSize = bytes - 4 - numRestarts * 4;
+            if (numRestarts == 0) {
+                return false; // The filter of no keys
+            }
+            thread_local std::string buffer;
+            range::Cursor cursor(filter.data(), entriesSize, filter.data() + entriesSize, numRestarts, buffer);
+            return fn(cursor);
+        }
+    };
+}
+
+inline const FilterPolicy* NewRangeFilterPolicy(size_t suffix_bytes) {
+    return new OrangeKV::RangeFilter(suffix_bytes);
+}
+
+#endif // RANGEFILTER_HPP
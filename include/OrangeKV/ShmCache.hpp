@@ -0,0 +1,453 @@
+#ifndef ORANGEKV_SHMCACHE_HPP
+#define ORANGEKV_SHMCACHE_HPP
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <string_view>
+#include <memory>
+#include <atomic>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+namespace OrangeKV {
+    /**
+     * The node of the shared memory cache. It has the same intrusive layout as
+     * LRUNode, but every link is an offset from the start of the mapped region
+     * instead of a raw pointer, so the region stays valid wherever it is mapped.
+     * An offset of 0 is the null link (offset 0 is always the region header).
+     */
+    struct ShmLRUNode {
+        uint64_t nextHash; // The next node in the same bucket, or in the free list
+        uint64_t next; // The next (older) node in the LRU list
+        uint64_t prev; // The previous (newer) node in the LRU list
+        uint32_t keyLength;
+        uint32_t valueLength;
+        uint32_t hash;
+        uint32_t in_cache;
+        char data[8]; // keyData followed by valueData, sized by the region geometry
+    };
+
+    struct ShmCacheOptions {
+        uint32_t slots = 1024; // The maximum number of entries
+        uint32_t buckets = 0; // The number of hash buckets, 0 means the same as slots
+        uint32_t maxKeyLength = 64; // The largest key that can be stored
+        uint32_t maxValueLength = 1024; // The largest value that can be stored
+    };
+
+    class ShmLRUCache {
+    private:
+        static constexpr uint64_t kMagic = 0x4f72616e67654b56; // "OrangeKV"
+        static constexpr uint32_t kVersion = 2;
+
+        // The header lives at offset 0 of the region and is shared by every process
+        struct Header {
+            std::atomic<uint64_t> magic; // Set last, once the region is fully initialized
+            uint32_t version;
+            uint32_t slots;
+            uint32_t buckets;
+            uint32_t maxKeyLength;
+            uint32_t maxValueLength;
+            uint32_t slotSize;
+            uint64_t regionSize;
+            uint64_t bucketsOffset;
+            uint64_t slotsOffset;
+            uint64_t newest; // The head of the LRU list
+            uint64_t oldest; // The tail of the LRU list
+            uint64_t freeList;
+            uint64_t elements;
+            uint64_t usage; // The total bytes of keys and values in the cache
+            uint32_t dirty; // Set while the mutex is held, left set by an update that was cut off
+            pthread_mutex_t mutex; // Process shared, so a sidecar can use the same cache
+        };
+
+        char* base_;
+        size_t size_;
+        Header* header_;
+        int fd_; // Kept open for the shared flock that marks the region as in use
+    public:
+        ShmLRUCache(const ShmLRUCache&) = delete;
+        ShmLRUCache& operator=(const ShmLRUCache&) = delete;
+        ~ShmLRUCache() {
+            munmap(base_, size_);
+            close(fd_); // Drops the flock
+        }
+
+        /**
+         * @brief Opens a cache in the named POSIX shared memory object, creating it if needed.
+         *
+         * The shared memory object outlives the process, so a restarted process reattaches to the
+         * warm cache. It is lost on reboot; use openFile() for a cache that must survive that too.
+         *
+         * @param name The name of the shared memory object, e.g. "/orangekv-cache".
+         * @param options The geometry of the cache, only used when the region is initialized.
+         * @return The cache, or nullptr if the object can't be opened or has a different geometry.
+         */
+        static std::unique_ptr<ShmLRUCache> openShm(const std::string& name, const ShmCacheOptions& options) {
+            int fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0600);
+            if (fd < 0) {
+                return nullptr;
+            }
+            return attach(fd, options);
+        }
+
+        /**
+         * @brief Opens a cache backed by a memory mapped file, creating it if needed.
+         *
+         * The file survives a reboot. The first process to attach after one finds a mutex that
+         * may still be marked as held by a thread of the previous boot, which nothing will ever
+         * release, so it initializes the mutex again; if an update was in progress when the
+         * system went down the entries are dropped too. Pages the kernel had only partly
+         * written back when the system crashed can't be detected.
+         *
+         * @param path The path of the backing file.
+         * @param options The geometry of the cache, only used when the region is initialized.
+         * @return The cache, or nullptr if the file can't be opened or has a different geometry.
+         */
+        static std::unique_ptr<ShmLRUCache> openFile(const std::string& path, const ShmCacheOptions& options) {
+            int fd = open(path.c_str(), O_RDWR | O_CREAT, 0600);
+            if (fd < 0) {
+                return nullptr;
+            }
+            return attach(fd, options);
+        }
+
+        // Remove the named shared memory object, mappings that are still open stay valid
+        static bool removeShm(const std::string& name) {
+            return shm_unlink(name.c_str()) == 0;
+        }
+
+        /**
+         * @brief Inserts or overwrites a key, evicting the least recently used entries if needed.
+         *
+         * @return false if the key or the value is larger than the region geometry allows, or the
+         * mutex of the region can't be taken.
+         */
+        bool insert(std::string_view key, uint32_t hash, std::string_view value) {
+            if (key.size() > header_->maxKeyLength || value.size() > header_->maxValueLength) {
+                return false;
+            }
+            Guard guard(this);
+            if (!guard.locked()) {
+                return false;
+            }
+            uint64_t* slot = findPointer(key, hash);
+            ShmLRUNode* node = nullptr;
+            if (*slot != 0) {
+                // Key already exists, overwrite the value in place and move it to the front
+                node = at(*slot);
+                lruRemove(node);
+                header_->usage -= node->valueLength;
+            }
+            else {
+                if (header_->freeList == 0) {
+                    evictOldest();
+                    slot = findPointer(key, hash); // The eviction may have changed the bucket chain
+                }
+                uint64_t offset = header_->freeList;
+                node = at(offset);
+                header_->freeList = node->nextHash;
+                node->nextHash = 0;
+                node->keyLength = static_cast<uint32_t>(key.size());
+                node->hash = hash;
+                node->in_cache = 1;
+                std::memcpy(node->data, key.data(), key.size());
+                *slot = offset;
+                header_->elements++;
+                header_->usage += key.size();
+            }
+            node->valueLength = static_cast<uint32_t>(value.size());
+            std::memcpy(node->data + node->keyLength, value.data(), value.size());
+            header_->usage += value.size();
+            lruAppend(node);
+            return true;
+        }
+
+        // Look up a key and copy its value out, the entry becomes the most recently used one
+        bool lookUp(std::string_view key, uint32_t hash, std::string* value) {
+            Guard guard(this);
+            if (!guard.locked()) {
+                return false;
+            }
+            uint64_t offset = *findPointer(key, hash);
+            if (offset == 0) {
+                return false;
+            }
+            ShmLRUNode* node = at(offset);
+            lruRemove(node);
+            lruAppend(node);
+            value->assign(node->data + node->keyLength, node->valueLength);
+            return true;
+        }
+
+        // false if the mutex of the region can't be taken
+        bool erase(std::string_view key, uint32_t hash) {
+            Guard guard(this);
+            if (!guard.locked()) {
+                return false;
+            }
+            uint64_t* slot = findPointer(key, hash);
+            if (*slot != 0) {
+                finishErase(slot);
+            }
+            return true;
+        }
+
+        // Drop every entry, the geometry of the region is kept; false if the mutex can't be taken
+        bool clear() {
+            Guard guard(this);
+            if (!guard.locked()) {
+                return false;
+            }
+            reset();
+            return true;
+        }
+
+        size_t size() const { // The number of entries in the cache
+            return header_->elements;
+        }
+        size_t capacity() const { // The maximum number of entries in the cache
+            return header_->slots;
+        }
+        size_t totalCharge() const { // The total bytes of keys and values in the cache
+            return header_->usage;
+        }
+    private:
+        /**
+         * Holds the process shared mutex, recovering the region if its previous owner died. The
+         * lock can fail, with ENOTRECOVERABLE after an owner died and its successor could not
+         * make the mutex consistent, or with an error of the mutex itself; then locked() is
+         * false, nothing is held and the operation must not touch the region.
+         */
+        class Guard {
+        private:
+            ShmLRUCache* cache;
+            bool held = false;
+        public:
+            explicit Guard(ShmLRUCache* cache) : cache(cache) {
+                pthread_mutex_t* mutex = &cache->header_->mutex;
+                int rc = pthread_mutex_lock(mutex);
+#if defined(__linux__)
+                if (rc == EOWNERDEAD) {
+                    // The owner died in the middle of an update, the links can't be trusted
+                    cache->reset();
+                    rc = pthread_mutex_consistent(mutex);
+                    if (rc != 0) {
+                        pthread_mutex_unlock(mutex); // Leaves it not recoverable, every later lock fails
+                    }
+                }
+#endif
+                held = rc == 0;
+                if (held) {
+                    cache->header_->dirty = 1;
+                }
+            }
+            Guard(const Guard&) = delete;
+            Guard& operator=(const Guard&) = delete;
+            ~Guard() {
+                if (held) {
+                    cache->header_->dirty = 0;
+                    pthread_mutex_unlock(&cache->header_->mutex);
+                }
+            }
+            bool locked() const {
+                return held;
+            }
+        };
+
+        ShmLRUCache(char* base, size_t size, int fd) : base_(base), size_(size), header_(reinterpret_cast<Header*>(base)), fd_(fd) {}
+
+        static void initMutex(Header* header) {
+            pthread_mutexattr_t attr;
+            pthread_mutexattr_init(&attr);
+            pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+#if defined(__linux__)
+            pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+#endif
+            pthread_mutex_init(&header->mutex, &attr);
+            pthread_mutexattr_destroy(&attr);
+        }
+
+        /**
+         * Maps the region and initializes it if it isn't yet. Every process that has the region
+         * mapped holds a shared flock on it, which the kernel drops when the process exits or
+         * dies and which doesn't survive a reboot. A process that gets the flock exclusively
+         * knows no other process has the region open: it initializes the region, or recovers
+         * one left by processes that are gone, and then turns its flock into a shared one.
+         * Until then others wait for a shared flock. Turning the flock into a shared one lets
+         * go of it for a moment, but a process that gets it exclusively in that moment is alone
+         * with a process that doesn't hold the mutex, so its recovery is harmless.
+         */
+        static std::unique_ptr<ShmLRUCache> attach(int fd, const ShmCacheOptions& options) {
+            uint32_t buckets = options.buckets != 0 ? options.buckets : options.slots;
+            size_t nodeSize = offsetof(ShmLRUNode, data) + options.maxKeyLength + options.maxValueLength;
+            size_t slotSize = (nodeSize + 7) & ~static_cast<size_t>(7);
+            size_t bucketsOffset = (sizeof(Header) + 63) & ~static_cast<size_t>(63);
+            size_t slotsOffset = bucketsOffset + sizeof(uint64_t) * buckets;
+            size_t regionSize = slotsOffset + slotSize * options.slots;
+            if (options.slots == 0 || buckets == 0) {
+                close(fd);
+                return nullptr;
+            }
+            bool alone = flock(fd, LOCK_EX | LOCK_NB) == 0;
+            if (!alone && flock(fd, LOCK_SH) != 0) {
+                close(fd);
+                return nullptr;
+            }
+            uint64_t magic = 0; // The first field of the header
+            bool initialized = pread(fd, &magic, sizeof(magic), 0) == static_cast<ssize_t>(sizeof(magic)) && magic == kMagic;
+            struct stat st;
+            if (!initialized) {
+                // Only a process alone with the region may initialize it. One that isn't found
+                // the region half initialized by a process that died, the next one alone fixes it
+                if (!alone || ftruncate(fd, static_cast<off_t>(regionSize)) != 0) {
+                    close(fd);
+                    return nullptr;
+                }
+            }
+            else if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(Header))) {
+                close(fd);
+                return nullptr;
+            }
+            else {
+                regionSize = static_cast<size_t>(st.st_size);
+            }
+            void* addr = mmap(nullptr, regionSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (addr == MAP_FAILED) {
+                close(fd);
+                return nullptr;
+            }
+            std::unique_ptr<ShmLRUCache> cache(new ShmLRUCache(static_cast<char*>(addr), regionSize, fd));
+            Header* header = cache->header_;
+            if (!initialized) {
+                header->version = kVersion;
+                header->slots = options.slots;
+                header->buckets = buckets;
+                header->maxKeyLength = options.maxKeyLength;
+                header->maxValueLength = options.maxValueLength;
+                header->slotSize = static_cast<uint32_t>(slotSize);
+                header->regionSize = regionSize;
+                header->bucketsOffset = bucketsOffset;
+                header->slotsOffset = slotsOffset;
+                header->dirty = 0;
+                initMutex(header);
+                cache->reset();
+                header->magic.store(kMagic, std::memory_order_release);
+            }
+            else if (header->version != kVersion || header->regionSize != regionSize || header->slots != options.slots
+                || header->maxKeyLength != options.maxKeyLength || header->maxValueLength != options.maxValueLength) {
+                return nullptr; // A region created with another geometry or layout
+            }
+            else if (alone) {
+                // No process has the region open, so no thread holds the mutex, but after a
+                // reboot its word may name a thread of the previous boot that will never let go
+                initMutex(header);
+                if (header->dirty != 0) { // An update was cut off, the links can't be trusted
+                    cache->reset();
+                    header->dirty = 0;
+                }
+            }
+            if (alone && flock(fd, LOCK_SH) != 0) {
+                return nullptr;
+            }
+            return cache;
+        }
+
+        ShmLRUNode* at(uint64_t offset) const {
+            return reinterpret_cast<ShmLRUNode*>(base_ + offset);
+        }
+        uint64_t offsetOf(const ShmLRUNode* node) const {
+            return static_cast<uint64_t>(reinterpret_cast<const char*>(node) - base_);
+        }
+        uint64_t* bucket(uint32_t hash) const {
+            return reinterpret_cast<uint64_t*>(base_ + header_->bucketsOffset) + hash % header_->buckets;
+        }
+
+        // Rebuild an empty cache: clear the buckets and thread every slot onto the free list
+        void reset() {
+            std::memset(base_ + header_->bucketsOffset, 0, sizeof(uint64_t) * header_->buckets);
+            uint64_t next = 0;
+            for (uint32_t i = header_->slots; i > 0; i--) {
+                uint64_t offset = header_->slotsOffset + static_cast<uint64_t>(header_->slotSize) * (i - 1);
+                ShmLRUNode* node = at(offset);
+                node->nextHash = next;
+                node->next = node->prev = 0;
+                node->in_cache = 0;
+                next = offset;
+            }
+            header_->freeList = next;
+            header_->newest = header_->oldest = 0;
+            header_->elements = 0;
+            header_->usage = 0;
+        }
+
+        // Return the link that points to the node of the key, or the null link at the end of its bucket
+        uint64_t* findPointer(std::string_view key, uint32_t hash) const {
+            uint64_t* ptr = bucket(hash);
+            while (*ptr != 0) {
+                ShmLRUNode* node = at(*ptr);
+                if (node->hash == hash && node->keyLength == key.size()
+                    && std::memcmp(node->data, key.data(), key.size()) == 0) {
+                    break;
+                }
+                ptr = &node->nextHash;
+            }
+            return ptr;
+        }
+
+        void lruRemove(ShmLRUNode* node) {
+            if (node->prev != 0) {
+                at(node->prev)->next = node->next;
+            }
+            else {
+                header_->newest = node->next;
+            }
+            if (node->next != 0) {
+                at(node->next)->prev = node->prev;
+            }
+            else {
+                header_->oldest = node->prev;
+            }
+            node->next = node->prev = 0;
+        }
+
+        void lruAppend(ShmLRUNode* node) { // Make the node the newest one
+            uint64_t offset = offsetOf(node);
+            node->prev = 0;
+            node->next = header_->newest;
+            if (header_->newest != 0) {
+                at(header_->newest)->prev = offset;
+            }
+            else {
+                header_->oldest = offset;
+            }
+            header_->newest = offset;
+        }
+
+        // Unlink the node that *slot points to and give it back to the free list
+        void finishErase(uint64_t* slot) {
+            ShmLRUNode* node = at(*slot);
+            *slot = node->nextHash;
+            lruRemove(node);
+            node->in_cache = 0;
+            header_->usage -= node->keyLength + node->valueLength;
+            header_->elements--;
+            node->nextHash = header_->freeList;
+            header_->freeList = offsetOf(node);
+        }
+
+        void evictOldest() {
+            ShmLRUNode* node = at(header_->oldest);
+            uint64_t* slot = bucket(node->hash);
+            while (*slot != header_->oldest) {
+                slot = &at(*slot)->nextHash;
+            }
+            finishErase(slot);
+        }
+    };
+}
+#endif
@@ -0,0 +1,337 @@
+#ifndef SKIPLIST_HPP
+#define SKIPLIST_HPP
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <thread>
+#include "utility/memory_pool.hpp"
+/*
+ * A skiplist whose nodes live in a memory pool and are never removed. Each node is
+ * allocated with exactly as many next links as its height, inline after the key.
+ *
+ * insert needs external synchronization, one writer at a time. insertConcurrently needs none
+ * and can run on many threads at once, given a Pool that can allocate from many threads such
+ * as ConcurrentMemoryPool: it links the node in level by level with a compare and swap, and
+ * searches again between the same two nodes when another thread linked a node there first.
+ * The two may not be mixed at the same time. Reads need no synchronization: a node is fully
+ * built before the release that links it in at level 0, so a reader that sees the link sees
+ * the node, and the pool keeps every node alive until the list is destroyed.
+ *
+ * A Splice remembers the nodes around the last key a thread inserted at every level. When the
+ * next key falls between the same nodes at some level, which it does for sequential keys, the
+ * search starts there instead of at the head, and an insert after the last one is close to
+ * constant time.
+ *
+ * Comparator is called as compare(a, b) and returns <0, 0 or >0.
+ */
+namespace OrangeKV {
+    template<typename Key, typename Comparator, typename Pool = MemoryPool>
+    class SkipList {
+    private:
+        struct Node;
+    public:
+        static constexpr int kMaxHeight = 12;
+        static constexpr uint32_t kBranching = 4; // A node is 1/kBranching as likely to reach the next level
+
+        // The pool must outlive the list
+        SkipList(Comparator compare, Pool* pool);
+        SkipList(const SkipList&) = delete;
+        SkipList& operator=(const SkipList&) = delete;
+
+        // Where the last insert of a thread went, one per thread and list
+        struct Splice {
+            int height = 0; // Levels below height are filled in, prev[height] is head and next[height] nullptr
+            Node* prev[kMaxHeight + 1];
+            Node* next[kMaxHeight + 1];
+        };
+
+        // Insert a key, nothing equal to it may be in the list
+        void insert(const Key& key);
+        // Insert a key, from any number of threads at once
+        void insertConcurrently(const Key& key);
+        void insertConcurrently(const Key& key, Splice* splice);
+        bool contains(const Key& key) const;
+
+        class Iterator {
+        private:
+            const SkipList* list;
+            Node* node = nullptr;
+        public:
+            explicit Iterator(const SkipList* list) : list(list) {}
+            bool valid() const {
+                return node != nullptr;
+            }
+            const Key& key() const {
+                assert(valid());
+                return node->key;
+            }
+            void next() {
+                assert(valid());
+                node = node->next(0);
+            }
+            void prev() { // Searches for the last node before this one, there are no back links
+                assert(valid());
+                node = list->findLessThan(node->key);
+                if (node == list->head) {
+                    node = nullptr;
+                }
+            }
+            // Move to the first key >= target
+            void seek(const Key& target) {
+                node = list->findGreaterOrEqual(target, nullptr);
+            }
+            void seekToFirst() {
+                node = list->head->next(0);
+            }
+            void seekToLast() {
+                node = list->findLast();
+                if (node == list->head) {
+                    node = nullptr;
+                }
+            }
+        };
+    private:
+        struct Node {
+            explicit Node(const Key& key) : key(key) {}
+            Key const key;
+
+            Node* next(int level) {
+                return next_[level].load(std::memory_order_acquire);
+            }
+            void setNext(int level, Node* node) {
+                next_[level].store(node, std::memory_order_release);
+            }
+            // For the writer, on links no reader can see yet
+            Node* noBarrierNext(int level) {
+                return next_[level].load(std::memory_order_relaxed);
+            }
+            void noBarrierSetNext(int level, Node* node) {
+                next_[level].store(node, std::memory_order_relaxed);
+            }
+            // Link node in after this one if the link is still expected, publishing node at level
+            bool casNext(int level, Node* expected, Node* node) {
+                return next_[level].compare_exchange_strong(expected, node, std::memory_order_release, std::memory_order_relaxed);
+            }
+        private:
+            std::atomic<Node*> next_[1]; // height links, allocated past the end of the node
+        };
+
+        Node* newNode(const Key& key, int height) {
+            char* memory = pool->allocateAligned(sizeof(Node) + sizeof(std::atomic<Node*>) * (height - 1));
+            return new (memory) Node(key);
+        }
+        static int randomHeight(uint32_t& random) {
+            int height = 1;
+            while (height < kMaxHeight && nextRandom(random) % kBranching == 0) {
+                height++;
+            }
+            return height;
+        }
+        static uint32_t nextRandom(uint32_t& random) { // xorshift32
+            random ^= random << 13;
+            random ^= random >> 17;
+            random ^= random << 5;
+            return random;
+        }
+        static uint32_t& threadRandom() { // The random state of the calling thread, for concurrent inserts
+            thread_local uint32_t random = static_cast<uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id())) | 1;
+            return random;
+        }
+        int getMaxHeight() const {
+            return maxHeight.load(std::memory_order_relaxed);
+        }
+        bool equal(const Key& a, const Key& b) const {
+            return compare(a, b) == 0;
+        }
+        bool keyIsAfterNode(const Key& key, Node* node) const { // nullptr is after every key
+            return node != nullptr && compare(node->key, key) < 0;
+        }
+
+        /**
+         * @brief Finds the first node >= key.
+         *
+         * @param prev If not nullptr, filled with the last node < key at every level.
+         */
+        Node* findGreaterOrEqual(const Key& key, Node** prev) const;
+        Node* findLessThan(const Key& key) const; // head if there is none
+        Node* findLast() const; // head if the list is empty
+        // Find the nodes around key at a level, searching forward from before and no further than after
+        void findSpliceForLevel(const Key& key, Node* before, Node* after, int level, Node** outPrev, Node** outNext) const;
+
+        Comparator const compare;
+        Pool* const pool;
+        Node* const head;
+        std::atomic<int> maxHeight; // Only grows, readers may see a stale value
+        uint32_t random;
+    };
+
+    template<typename Key, typename Comparator, typename Pool>
+    SkipList<Key, Comparator, Pool>::SkipList(Comparator compare, Pool* pool)
+        : compare(compare), pool(pool), head(newNode(Key(), kMaxHeight)), maxHeight(1), random(0xdeadbeef) {
+        for (int i = 0; i < kMaxHeight; i++) {
+            head->setNext(i, nullptr);
+        }
+    }
+
+    template<typename Key, typename Comparator, typename Pool>
+    typename SkipList<Key, Comparator, Pool>::Node* SkipList<Key, Comparator, Pool>::findGreaterOrEqual(const Key& key, Node** prev) const {
+        Node* x = head;
+        int level = getMaxHeight() - 1;
+        while (true) {
+            Node* next = x->next(level);
+            if (keyIsAfterNode(key, next)) {
+                x = next;
+            }
+            else {
+                if (prev != nullptr) {
+                    prev[level] = x;
+                }
+                if (level == 0) {
+                    return next;
+                }
+                level--;
+            }
+        }
+    }
+
+    template<typename Key, typename Comparator, typename Pool>
+    typename SkipList<Key, Comparator, Pool>::Node* SkipList<Key, Comparator, Pool>::findLessThan(const Key& key) const {
+        Node* x = head;
+        int level = getMaxHeight() - 1;
+        while (true) {
+            Node* next = x->next(level);
+            if (next == nullptr || compare(next->key, key) >= 0) {
+                if (level == 0) {
+                    return x;
+                }
+                level--;
+            }
+            else {
+                x = next;
+            }
+        }
+    }
+
+    template<typename Key, typename Comparator, typename Pool>
+    typename SkipList<Key, Comparator, Pool>::Node* SkipList<Key, Comparator, Pool>::findLast() const {
+        Node* x = head;
+        int level = getMaxHeight() - 1;
+        while (true) {
+            Node* next = x->next(level);
+            if (next == nullptr) {
+                if (level == 0) {
+                    return x;
+                }
+                level--;
+            }
+            else {
+                x = next;
+            }
+        }
+    }
+
+    template<typename Key, typename Comparator, typename Pool>
+    void SkipList<Key, Comparator, Pool>::insert(const Key& key) {
+        Node* prev[kMaxHeight];
+        Node* x = findGreaterOrEqual(key, prev);
+        assert(x == nullptr || !equal(key, x->key));
+        int height = randomHeight(random);
+        if (height > getMaxHeight()) {
+            for (int i = getMaxHeight(); i < height; i++) {
+                prev[i] = head;
+            }
+            // A reader that sees the new height before the node finds nullptr links from head
+            // at the new levels, which it treats as the end of those levels and moves down
+            maxHeight.store(height, std::memory_order_relaxed);
+        }
+        x = newNode(key, height);
+        for (int i = 0; i < height; i++) {
+            x->noBarrierSetNext(i, prev[i]->noBarrierNext(i));
+            prev[i]->setNext(i, x); // Publishes x at level i
+        }
+    }
+
+    template<typename Key, typename Comparator, typename Pool>
+    void SkipList<Key, Comparator, Pool>::findSpliceForLevel(const Key& key, Node* before, Node* after, int level, Node** outPrev, Node** outNext) const {
+        while (true) {
+            Node* next = before->next(level);
+            if (next == after || !keyIsAfterNode(key, next)) {
+                *outPrev = before;
+                *outNext = next;
+                return;
+            }
+            before = next;
+        }
+    }
+
+    template<typename Key, typename Comparator, typename Pool>
+    void SkipList<Key, Comparator, Pool>::insertConcurrently(const Key& key) {
+        Splice splice;
+        insertConcurrently(key, &splice);
+    }
+
+    template<typename Key, typename Comparator, typename Pool>
+    void SkipList<Key, Comparator, Pool>::insertConcurrently(const Key& key, Splice* splice) {
+        int height = randomHeight(threadRandom());
+        int top = getMaxHeight();
+        while (height > top) {
+            if (maxHeight.compare_exchange_weak(top, height, std::memory_order_relaxed)) {
+                top = height;
+                break;
+            }
+        }
+
+        // The lowest level at which the splice still has key between its two nodes. Nodes are
+        // never removed, so a pair that had key between them still does, with maybe new nodes
+        // in between that the search below walks over
+        int recompute = 0;
+        if (splice->height < top) {
+            splice->prev[top] = head;
+            splice->next[top] = nullptr;
+            splice->height = top;
+            recompute = top;
+        }
+        else {
+            while (recompute < top) {
+                Node* before = splice->prev[recompute];
+                Node* after = splice->next[recompute];
+                if ((before == head || keyIsAfterNode(key, before)) && (after == nullptr || compare(key, after->key) < 0)) {
+                    break;
+                }
+                recompute++;
+            }
+        }
+        for (int i = recompute - 1; i >= 0; i--) {
+            findSpliceForLevel(key, splice->prev[i + 1], splice->next[i + 1], i, &splice->prev[i], &splice->next[i]);
+        }
+        assert(splice->next[0] == nullptr || !equal(key, splice->next[0]->key));
+
+        Node* x = newNode(key, height);
+        for (int i = 0; i < height; i++) {
+            while (true) {
+                x->noBarrierSetNext(i, splice->next[i]);
+                if (splice->prev[i]->casNext(i, splice->next[i], x)) {
+                    break;
+                }
+                // Another thread linked a node in between, which is still before next
+                findSpliceForLevel(key, splice->prev[i], splice->next[i], i, &splice->prev[i], &splice->next[i]);
+            }
+        }
+        // The next key of a sequential writer comes right after this one
+        for (int i = 0; i < height; i++) {
+            splice->prev[i] = x;
+        }
+    }
+
+    template<typename Key, typename Comparator, typename Pool>
+    bool SkipList<Key, Comparator, Pool>::contains(const Key& key) const {
+        Node* x = findGreaterOrEqual(key, nullptr);
+        return x != nullptr && equal(key, x->key);
+    }
+}
+
+#endif // SKIPLIST_HPP
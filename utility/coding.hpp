@@ -0,0 +1,123 @@
+#ifndef CODING_HPP
+#define CODING_HPP
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+/*
+ * Encoding of integers into byte strings. Fixed width integers are stored little endian and
+ * varints use 7 bits per byte with the high bit set on every byte but the last.
+ */
+namespace OrangeKV {
+    inline void PutFixed32(std::string& dest, uint32_t value) {
+        char buf[4];
+        for (int i = 0; i < 4; i++) {
+            buf[i] = static_cast<char>(value >> (8 * i));
+        }
+        dest.append(buf, 4);
+    }
+
+    inline uint32_t DecodeFixed32(const char* p) {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; i++) {
+            value |= static_cast<uint32_t>(static_cast<uint8_t>(p[i])) << (8 * i);
+        }
+        return value;
+    }
+
+    inline void PutFixed64(std::string& dest, uint64_t value) {
+        char buf[8];
+        for (int i = 0; i < 8; i++) {
+            buf[i] = static_cast<char>(value >> (8 * i));
+        }
+        dest.append(buf, 8);
+    }
+
+    inline uint64_t DecodeFixed64(const char* p) {
+        uint64_t value = 0;
+        for (int i = 0; i < 8; i++) {
+            value |= static_cast<uint64_t>(static_cast<uint8_t>(p[i])) << (8 * i);
+        }
+        return value;
+    }
+
+    // Write a varint to dest, which must have room for VarintLength(value) bytes
+    inline char* EncodeVarint64(char* dest, uint64_t value) {
+        uint8_t* p = reinterpret_cast<uint8_t*>(dest);
+        while (value >= 0x80) {
+            *p++ = static_cast<uint8_t>(value | 0x80);
+            value >>= 7;
+        }
+        *p++ = static_cast<uint8_t>(value);
+        return reinterpret_cast<char*>(p);
+    }
+
+    inline void PutVarint64(std::string& dest, uint64_t value) {
+        char buf[10];
+        dest.append(buf, EncodeVarint64(buf, value) - buf);
+    }
+
+    inline void PutVarint32(std::string& dest, uint32_t value) {
+        PutVarint64(dest, value);
+    }
+
+    inline size_t VarintLength(uint64_t value) {
+        size_t length = 1;
+        while (value >= 0x80) {
+            value >>= 7;
+            length++;
+        }
+        return length;
+    }
+
+    /**
+     * @brief Decodes a varint from the front of [p, limit).
+     *
+     * @return The byte after the varint, nullptr if it is truncated or too long.
+     */
+    inline const char* GetVarint64(const char* p, const char* limit, uint64_t* value) {
+        uint64_t result = 0;
+        for (uint32_t shift = 0; shift <= 63 && p < limit; shift += 7) {
+            uint64_t byte = static_cast<uint8_t>(*p++);
+            result |= (byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                *value = result;
+                return p;
+            }
+        }
+        return nullptr;
+    }
+
+    inline const char* GetVarint32(const char* p, const char* limit, uint32_t* value) {
+        if (p < limit && (static_cast<uint8_t>(*p) & 0x80) == 0) { // Most lengths fit in one byte
+            *value = static_cast<uint8_t>(*p);
+            return p + 1;
+        }
+        uint64_t result;
+        p = GetVarint64(p, limit, &result);
+        if (p == nullptr || result > UINT32_MAX) {
+            return nullptr;
+        }
+        *value = static_cast<uint32_t>(result);
+        return p;
+    }
+
+    // Append a length prefixed string
+    inline void PutLengthPrefixed(std::string& dest, std::string_view value) {
+        PutVarint32(dest, static_cast<uint32_t>(value.size()));
+        dest.append(value.data(), value.size());
+    }
+
+    // Read a length prefixed string from the front of input and drop it, false if it is malformed
+    inline bool GetLengthPrefixed(std::string_view& input, std::string_view& result) {
+        uint32_t length;
+        const char* p = GetVarint32(input.data(), input.data() + input.size(), &length);
+        if (p == nullptr || length > static_cast<size_t>(input.data() + input.size() - p)) {
+            return false;
+        }
+        result = std::string_view(p, length);
+        input.remove_prefix(p + length - input.data());
+        return true;
+    }
+}
+#endif // CODING_HPP
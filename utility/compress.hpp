@@ -0,0 +1,189 @@
+#ifndef COMPRESS_HPP
+#define COMPRESS_HPP
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+namespace OrangeKV {
+    /*
+     * A dependency free LZ77 codec that writes the LZ4 block format: a sequence is a token
+     * (literal length in the high nibble, match length - 4 in the low nibble), optional
+     * extra literal length bytes, the literals, a 2 byte little endian offset and optional
+     * extra match length bytes. The last sequence only has literals.
+     */
+    namespace lz {
+        constexpr size_t kMinMatch = 4;
+        constexpr size_t kLastLiterals = 5; // The last bytes are always literals
+        constexpr size_t kMatchFindLimit = 12; // No match starts in the last bytes
+        constexpr size_t kMaxOffset = 65535;
+        constexpr uint32_t kHashLog = 12;
+
+        inline uint32_t load32(const char* p) {
+            uint32_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+        inline uint32_t hashSequence(uint32_t sequence) {
+            return (sequence * 2654435761U) >> (32 - kHashLog);
+        }
+        // Write a length of 15 or more as a run of 255 bytes and the remainder
+        inline char* writeLength(char* op, size_t length) {
+            while (length >= 255) {
+                *op++ = static_cast<char>(255);
+                length -= 255;
+            }
+            *op++ = static_cast<char>(length);
+            return op;
+        }
+        inline bool readLength(const uint8_t*& ip, const uint8_t* end, size_t& length) {
+            uint8_t b;
+            do {
+                if (ip >= end) {
+                    return false;
+                }
+                b = *ip++;
+                length += b;
+            } while (b == 255);
+            return true;
+        }
+    }
+
+    /**
+     * @brief Returns the largest size LZCompress can produce for an input of n bytes.
+     */
+    inline size_t LZMaxCompressedLength(size_t n) {
+        return n + n / 255 + 16;
+    }
+
+    /**
+     * @brief Compresses the data with a greedy LZ77 match finder.
+     *
+     * @param src The input data.
+     * @param n The length of the input data.
+     * @param dst The output buffer.
+     * @param capacity The size of the output buffer.
+     * @return The compressed length, or 0 if the output does not fit in capacity.
+     */
+    inline size_t LZCompress(const char* src, size_t n, char* dst, size_t capacity) {
+        char* op = dst;
+        char* const opEnd = dst + capacity;
+        size_t anchor = 0;
+        if (n > lz::kMatchFindLimit) {
+            uint32_t table[1 << lz::kHashLog] = {0};
+            const size_t matchFindLimit = n - lz::kMatchFindLimit;
+            const size_t matchLimit = n - lz::kLastLiterals;
+            size_t ip = 1;
+            size_t misses = 0;
+            table[lz::hashSequence(lz::load32(src))] = 0;
+            while (ip <= matchFindLimit) {
+                uint32_t sequence = lz::load32(src + ip);
+                uint32_t h = lz::hashSequence(sequence);
+                size_t ref = table[h];
+                table[h] = static_cast<uint32_t>(ip);
+                if (ref >= ip || ip - ref > lz::kMaxOffset || lz::load32(src + ref) != sequence) {
+                    ip += 1 + (misses++ >> 6); // Skip faster through incompressible data
+                    continue;
+                }
+                misses = 0;
+                while (ip > anchor && ref > 0 && src[ip - 1] == src[ref - 1]) { // Extend the match backwards
+                    ip--;
+                    ref--;
+                }
+                size_t matchLength = lz::kMinMatch;
+                while (ip + matchLength < matchLimit && src[ip + matchLength] == src[ref + matchLength]) {
+                    matchLength++;
+                }
+                size_t literalLength = ip - anchor;
+                if (static_cast<size_t>(opEnd - op) < 1 + literalLength + literalLength / 255 + 2 + matchLength / 255 + 2) {
+                    return 0;
+                }
+                char* token = op++;
+                size_t matchCode = matchLength - lz::kMinMatch;
+                *token = static_cast<char>(((literalLength < 15 ? literalLength : 15) << 4) | (matchCode < 15 ? matchCode : 15));
+                if (literalLength >= 15) {
+                    op = lz::writeLength(op, literalLength - 15);
+                }
+                std::memcpy(op, src + anchor, literalLength);
+                op += literalLength;
+                size_t offset = ip - ref;
+                *op++ = static_cast<char>(offset & 0xff);
+                *op++ = static_cast<char>(offset >> 8);
+                if (matchCode >= 15) {
+                    op = lz::writeLength(op, matchCode - 15);
+                }
+                ip += matchLength;
+                anchor = ip;
+                if (ip <= matchFindLimit) {
+                    table[lz::hashSequence(lz::load32(src + ip - 2))] = static_cast<uint32_t>(ip - 2);
+                }
+            }
+        }
+        size_t literalLength = n - anchor;
+        if (static_cast<size_t>(opEnd - op) < 1 + literalLength + literalLength / 255 + 1) {
+            return 0;
+        }
+        *op++ = static_cast<char>((literalLength < 15 ? literalLength : 15) << 4);
+        if (literalLength >= 15) {
+            op = lz::writeLength(op, literalLength - 15);
+        }
+        std::memcpy(op, src + anchor, literalLength);
+        op += literalLength;
+        return static_cast<size_t>(op - dst);
+    }
+
+    /**
+     * @brief Decompresses data produced by LZCompress.
+     *
+     * @param src The compressed data.
+     * @param n The length of the compressed data.
+     * @param dst The output buffer, at least rawLength bytes.
+     * @param rawLength The length of the original data.
+     * @return false if the compressed data is corrupted or does not decode to exactly rawLength bytes.
+     */
+    inline bool LZDecompress(const char* src, size_t n, char* dst, size_t rawLength) {
+        const uint8_t* ip = reinterpret_cast<const uint8_t*>(src);
+        const uint8_t* const ipEnd = ip + n;
+        char* op = dst;
+        char* const opEnd = dst + rawLength;
+        while (ip < ipEnd) {
+            uint8_t token = *ip++;
+            size_t literalLength = token >> 4;
+            if (literalLength == 15 && !lz::readLength(ip, ipEnd, literalLength)) {
+                return false;
+            }
+            if (literalLength > static_cast<size_t>(ipEnd - ip) || literalLength > static_cast<size_t>(opEnd - op)) {
+                return false;
+            }
+            std::memcpy(op, ip, literalLength);
+            ip += literalLength;
+            op += literalLength;
+            if (ip == ipEnd) {
+                break; // The last sequence has no match
+            }
+            if (ipEnd - ip < 2) {
+                return false;
+            }
+            size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+            ip += 2;
+            size_t matchLength = token & 15;
+            if (matchLength == 15 && !lz::readLength(ip, ipEnd, matchLength)) {
+                return false;
+            }
+            matchLength += lz::kMinMatch;
+            if (offset == 0 || offset > static_cast<size_t>(op - dst) || matchLength > static_cast<size_t>(opEnd - op)) {
+                return false;
+            }
+            const char* match = op - offset;
+            if (offset >= matchLength) {
+                std::memcpy(op, match, matchLength);
+                op += matchLength;
+            }
+            else {
+                for (size_t i = 0; i < matchLength; i++) { // Overlapping copy repeats the pattern
+                    *op++ = *match++;
+                }
+            }
+        }
+        return op == opEnd;
+    }
+}
+#endif // COMPRESS_HPP
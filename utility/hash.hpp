@@ -3,14 +3,69 @@
 #include <unistd.h>
 #include <cstdint>
 #include <cstddef>
+#include <cstring>
 #include <string> 
+#include <string_view>
+#include <bit>
+#include <type_traits>
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define ORANGEKV_CRC32C_X86 1
+#include <immintrin.h>
+#endif
 namespace OrangeKV {
-    uint32_t HashBKDR(const std::string& data, size_t n, uint32_t seed);
-    uint32_t HashDJB(const std::string& data, size_t n, uint32_t seed);
-    uint32_t HashSDBM(const std::string& data, size_t n, uint32_t seed);
-    uint32_t HashAP(const std::string& data, size_t n, uint32_t seed);
-    uint32_t MurmurHash3_x86_32(const std::string& data, size_t n, uint32_t seed);
-    uint32_t MurmurHash3_x86_64(const std::string& data, size_t n, uint32_t seed); 
+    struct Hash128 {
+        uint64_t low;
+        uint64_t high;
+    };
+    constexpr uint32_t HashBKDR(std::string_view data, uint32_t seed);
+    constexpr uint32_t HashDJB(std::string_view data, uint32_t seed);
+    constexpr uint32_t HashSDBM(std::string_view data, uint32_t seed);
+    constexpr uint32_t HashAP(std::string_view data, uint32_t seed);
+    constexpr uint32_t MurmurHash3_x86_32(std::string_view data, uint32_t seed);
+    constexpr uint64_t MurmurHash3_x86_64(std::string_view data, uint32_t seed);
+    constexpr Hash128 MurmurHash3_x64_128(std::string_view data, uint64_t seed);
+    constexpr uint64_t WyHash64(std::string_view data, uint64_t seed);
+    inline uint32_t Crc32cExtend(uint32_t crc, const void* data, size_t n);
+
+    // Loads that are safe on unaligned addresses, the compiler turns them into plain moves
+    inline uint32_t LoadFixed32(const void* p) {
+        uint32_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+    inline uint64_t LoadFixed64(const void* p) {
+        uint64_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+    // The same loads on chars, which also work in constant expressions
+    constexpr uint32_t LoadFixed32(const char* p) {
+        if (std::is_constant_evaluated()) {
+            uint32_t v = 0;
+            for (int i = 0; i < 4; i++) {
+                int shift = std::endian::native == std::endian::little ? 8 * i : 8 * (3 - i);
+                v |= static_cast<uint32_t>(static_cast<uint8_t>(p[i])) << shift;
+            }
+            return v;
+        }
+        return LoadFixed32(static_cast<const void*>(p));
+    }
+    constexpr uint64_t LoadFixed64(const char* p) {
+        if (std::is_constant_evaluated()) {
+            uint64_t v = 0;
+            for (int i = 0; i < 8; i++) {
+                int shift = std::endian::native == std::endian::little ? 8 * i : 8 * (7 - i);
+                v |= static_cast<uint64_t>(static_cast<uint8_t>(p[i])) << shift;
+            }
+            return v;
+        }
+        return LoadFixed64(static_cast<const void*>(p));
+    }
+    constexpr uint64_t Rotl64(uint64_t x, int r) {
+        return (x << r) | (x >> (64 - r));
+    }
+
+
     /**
      * @brief Calculates the BKDR hash value for the given data.
      * 
@@ -19,14 +74,25 @@ namespace OrangeKV {
      * @param seed The initial seed value for the hash calculation.
      * @return The calculated BKDR hash value.
      */
-    uint32_t HashBKDR(const std::string& data, size_t n, uint32_t seed = 131) {
+    constexpr uint32_t HashBKDR(std::string_view data, uint32_t seed = 131) {
         uint32_t hash = 0;
-        for (size_t i = 0; i < n; i++) {
+        for (size_t i = 0; i < data.size(); i++) {
             hash = (hash * seed) + data[i];
         }
         return hash;
     }
-    
+
+    constexpr uint32_t HashBKDR(const std::string& data, size_t n, uint32_t seed = 131) {
+        return HashBKDR(std::string_view(data.data(), n), seed);
+    }
+
+    // Adapts HashBKDR to the Hash requirement of the standard containers
+    struct BKDRHasher {
+        constexpr size_t operator()(const std::string& key) const {
+            return HashBKDR(key, key.size());
+        }
+    };
+
 
     /**
      * @brief Calculates the DJB hash value for the given data.
@@ -36,14 +102,18 @@ namespace OrangeKV {
      * @param seed The initial seed value for the hash calculation.
      * @return The calculated DJB hash value.
      */
-    uint32_t HashDJB(const std::string& data, size_t n, uint32_t seed = 5381) {
+    constexpr uint32_t HashDJB(std::string_view data, uint32_t seed = 5381) {
         uint32_t hash = seed;
-        for (size_t i = 0; i < n; i++) {
+        for (size_t i = 0; i < data.size(); i++) {
             hash = ((hash << 5) + hash) + data[i];
         }
         return hash;
     }
 
+    constexpr uint32_t HashDJB(const std::string& data, size_t n, uint32_t seed = 5381) {
+        return HashDJB(std::string_view(data.data(), n), seed);
+    }
+
 
     /**
      * @brief Calculates the SDBM hash value for the given data.
@@ -53,14 +123,18 @@ namespace OrangeKV {
      * @param seed The initial seed value for the hash calculation.
      * @return The calculated SDBM hash value.
      */
-    uint32_t HashSDBM(const std::string& data, size_t n, uint32_t seed = 0) {
+    constexpr uint32_t HashSDBM(std::string_view data, uint32_t seed = 0) {
         uint32_t hash = seed;
-        for (size_t i = 0; i < n; i++) {
+        for (size_t i = 0; i < data.size(); i++) {
             hash = data[i] + (hash << 6) + (hash << 16) - hash;
         }
         return hash;
     }
 
+    constexpr uint32_t HashSDBM(const std::string& data, size_t n, uint32_t seed = 0) {
+        return HashSDBM(std::string_view(data.data(), n), seed);
+    }
+
 
     /**
      * @brief Calculates the AP hash value for the given data.
@@ -70,9 +144,9 @@ namespace OrangeKV {
      * @param seed The initial seed value for the hash calculation.
      * @return The calculated AP hash value.
      */
-    uint32_t HashAP(const std::string& data, size_t n, uint32_t seed = 0) {
+    constexpr uint32_t HashAP(std::string_view data, uint32_t seed = 0) {
         uint32_t hash = seed;
-        for (size_t i = 0; i < n; i++) {
+        for (size_t i = 0; i < data.size(); i++) {
             if (i & 1) {
                 hash ^= ((hash << 7) ^ data[i] ^ (hash >> 3));
             } else {
@@ -82,16 +156,20 @@ namespace OrangeKV {
         return hash;
     }
 
+    constexpr uint32_t HashAP(const std::string& data, size_t n, uint32_t seed = 0) {
+        return HashAP(std::string_view(data.data(), n), seed);
+    }
+
 
     /**
      * @brief Calculates the MurmurHash3_x86_32 hash value for the given data.
      * 
-     * @param data The input string.
-     * @param n The length of the input string.
+     * @param data The input data, it does not need to be aligned.
+     * @param n The length of the input data.
      * @param seed The initial seed value for the hash calculation.
      * @return The calculated MurmurHash3_x86_32 hash value.
      */
-    uint32_t MurmurHash3_x86_32(const std::string& data, size_t n, uint32_t seed = 0) {
+    constexpr uint32_t MurmurHash3_x86_32(std::string_view data, uint32_t seed = 0) {
         const uint32_t c1 = 0xcc9e2d51;
         const uint32_t c2 = 0x1b873593;
         const uint32_t r1 = 15;
@@ -100,13 +178,13 @@ namespace OrangeKV {
         const uint32_t n1 = 0xe6546b64;
 
         uint32_t hash = seed;
-        size_t len = n;
+        size_t len = data.size();
 
-        const uint32_t* chunks = reinterpret_cast<const uint32_t*>(data.c_str());
+        const char* chunks = data.data();
         const size_t numChunks = len / 4;
 
         for (size_t i = 0; i < numChunks; ++i) {
-            uint32_t k = chunks[i];
+            uint32_t k = LoadFixed32(chunks + i * 4);
             k *= c1;
             k = (k << r1) | (k >> (32 - r1));
             k *= c2;
@@ -115,19 +193,19 @@ namespace OrangeKV {
             hash = ((hash << r2) | (hash >> (32 - r2))) * m + n1;
         }
 
-        const uint8_t* tail = reinterpret_cast<const uint8_t*>(data.c_str() + numChunks * 4);
+        const char* tail = chunks + numChunks * 4;
         uint32_t k1 = 0;
         //Case 3, 2, 1 all will be executed!
         //The attribute [[fallthrough]] in C++17
         switch (len & 3) {
             case 3:
-                k1 ^= tail[2] << 16;
+                k1 ^= static_cast<uint8_t>(tail[2]) << 16;
                 [[fallthrough]];
             case 2:
-                k1 ^= tail[1] << 8;
+                k1 ^= static_cast<uint8_t>(tail[1]) << 8;
                 [[fallthrough]];
             case 1:
-                k1 ^= tail[0];
+                k1 ^= static_cast<uint8_t>(tail[0]);
                 k1 *= c1;
                 k1 = (k1 << r1) | (k1 >> (32 - r1));
                 k1 *= c2;
@@ -142,78 +220,457 @@ namespace OrangeKV {
         return hash;
     }
 
+    inline uint32_t MurmurHash3_x86_32(const void* data, size_t n, uint32_t seed = 0) {
+        return MurmurHash3_x86_32(std::string_view(static_cast<const char*>(data), n), seed);
+    }
+
+    constexpr uint32_t MurmurHash3_x86_32(const std::string& data, size_t n, uint32_t seed = 0) {
+        return MurmurHash3_x86_32(std::string_view(data.data(), n), seed);
+    }
+
 
     /**
-     * @brief Calculates the MurmurHash3_x86_64 hash value for the given data.
-     * 
-     * @param data The input string.
-     * @param n The length of the input string.
+     * @brief Calculates the MurmurHash3_x64_128 hash value for the given data.
+     *
+     * @param data The input data, it does not need to be aligned.
+     * @param n The length of the input data.
      * @param seed The initial seed value for the hash calculation.
-     * @return The calculated MurmurHash3_x86_64 hash value.
+     * @return The calculated 128 bit MurmurHash3_x64_128 hash value.
      */
-    uint32_t MurmurHash3_x86_64(const std::string& data, size_t n, uint32_t seed = 0) {
-        const uint64_t c1 = 0x87c37b91114253d5;
-        const uint64_t c2 = 0x4cf5ad432745937f;
-        const uint32_t r1 = 31;
-        const uint32_t r2 = 27;
-        const uint32_t r3 = 33;
-        const uint32_t m = 5;
-        const uint32_t n1 = 0x52dce729;
-        const uint32_t n2 = 0x38495ab5;
-
-        uint64_t hash = seed;
-        size_t len = n;
-
-        const uint64_t* chunks = reinterpret_cast<const uint64_t*>(data.c_str());
-        const size_t numChunks = len / 8;
+    constexpr Hash128 MurmurHash3_x64_128(std::string_view data, uint64_t seed = 0) {
+        const uint64_t c1 = 0x87c37b91114253d5ULL;
+        const uint64_t c2 = 0x4cf5ad432745937fULL;
+        const size_t n = data.size();
+        const char* bytes = data.data();
+        const size_t numChunks = n / 16;
+        uint64_t h1 = seed;
+        uint64_t h2 = seed;
 
         for (size_t i = 0; i < numChunks; ++i) {
-            uint64_t k = chunks[i];
-            k *= c1;
-            k = (k << r1) | (k >> (64 - r1));
-            k *= c2;
-
-            hash ^= k;
-            hash = ((hash << r2) | (hash >> (64 - r2))) * m + n1;
+            uint64_t k1 = LoadFixed64(bytes + i * 16);
+            uint64_t k2 = LoadFixed64(bytes + i * 16 + 8);
+            k1 *= c1;
+            k1 = Rotl64(k1, 31);
+            k1 *= c2;
+            h1 ^= k1;
+            h1 = Rotl64(h1, 27);
+            h1 += h2;
+            h1 = h1 * 5 + 0x52dce729;
+            k2 *= c2;
+            k2 = Rotl64(k2, 33);
+            k2 *= c1;
+            h2 ^= k2;
+            h2 = Rotl64(h2, 31);
+            h2 += h1;
+            h2 = h2 * 5 + 0x38495ab5;
         }
 
-        const uint8_t* tail = reinterpret_cast<const uint8_t*>(data.c_str() + numChunks * 8);
+        const char* tail = bytes + numChunks * 16;
+        auto byte = [tail](int i) {
+            return static_cast<uint64_t>(static_cast<uint8_t>(tail[i]));
+        };
         uint64_t k1 = 0;
-
-        switch (len & 7) {
-            case 7:
-                k1 ^= static_cast<uint64_t>(tail[6]) << 48;
-                [[fallthrough]];
-            case 6:
-                k1 ^= static_cast<uint64_t>(tail[5]) << 40;
-                [[fallthrough]];
-            case 5:
-                k1 ^= static_cast<uint64_t>(tail[4]) << 32;
-                [[fallthrough]];
-            case 4:
-                k1 ^= static_cast<uint64_t>(tail[3]) << 24;
-                [[fallthrough]];
-            case 3:
-                k1 ^= static_cast<uint64_t>(tail[2]) << 16;
-                [[fallthrough]];
-            case 2:
-                k1 ^= static_cast<uint64_t>(tail[1]) << 8;
+        uint64_t k2 = 0;
+        switch (n & 15) {
+            case 15: k2 ^= byte(14) << 48; [[fallthrough]];
+            case 14: k2 ^= byte(13) << 40; [[fallthrough]];
+            case 13: k2 ^= byte(12) << 32; [[fallthrough]];
+            case 12: k2 ^= byte(11) << 24; [[fallthrough]];
+            case 11: k2 ^= byte(10) << 16; [[fallthrough]];
+            case 10: k2 ^= byte(9) << 8; [[fallthrough]];
+            case 9:
+                k2 ^= byte(8);
+                k2 *= c2;
+                k2 = Rotl64(k2, 33);
+                k2 *= c1;
+                h2 ^= k2;
                 [[fallthrough]];
+            case 8: k1 ^= byte(7) << 56; [[fallthrough]];
+            case 7: k1 ^= byte(6) << 48; [[fallthrough]];
+            case 6: k1 ^= byte(5) << 40; [[fallthrough]];
+            case 5: k1 ^= byte(4) << 32; [[fallthrough]];
+            case 4: k1 ^= byte(3) << 24; [[fallthrough]];
+            case 3: k1 ^= byte(2) << 16; [[fallthrough]];
+            case 2: k1 ^= byte(1) << 8; [[fallthrough]];
             case 1:
-                k1 ^= static_cast<uint64_t>(tail[0]);
+                k1 ^= byte(0);
                 k1 *= c1;
-                k1 = (k1 << r1) | (k1 >> (64 - r1));
+                k1 = Rotl64(k1, 31);
                 k1 *= c2;
-                hash ^= k1;
+                h1 ^= k1;
         }
 
-        hash ^= len;
-        hash ^= (hash >> r3);
-        hash *= n2;
-        hash ^= (hash >> r2);
-        hash *= n1;
-        hash ^= (hash >> r3);
-        return static_cast<uint32_t>(hash);
+        auto fmix64 = [](uint64_t k) {
+            k ^= k >> 33;
+            k *= 0xff51afd7ed558ccdULL;
+            k ^= k >> 33;
+            k *= 0xc4ceb9fe1a85ec53ULL;
+            k ^= k >> 33;
+            return k;
+        };
+        h1 ^= n;
+        h2 ^= n;
+        h1 += h2;
+        h2 += h1;
+        h1 = fmix64(h1);
+        h2 = fmix64(h2);
+        h1 += h2;
+        h2 += h1;
+        return Hash128{h1, h2};
+    }
+
+    inline Hash128 MurmurHash3_x64_128(const void* data, size_t n, uint64_t seed = 0) {
+        return MurmurHash3_x64_128(std::string_view(static_cast<const char*>(data), n), seed);
+    }
+
+
+    /**
+     * @brief Calculates the 64 bit MurmurHash3 hash value for the given data.
+     *
+     * This is the low half of MurmurHash3_x64_128, not a separate MurmurHash3 variant.
+     *
+     * @param data The input string.
+     * @param n The length of the input string.
+     * @param seed The initial seed value for the hash calculation.
+     * @return The calculated 64 bit MurmurHash3 hash value.
+     */
+    constexpr uint64_t MurmurHash3_x86_64(std::string_view data, uint32_t seed = 0) {
+        return MurmurHash3_x64_128(data, seed).low;
+    }
+
+    constexpr uint64_t MurmurHash3_x86_64(const std::string& data, size_t n, uint32_t seed = 0) {
+        return MurmurHash3_x86_64(std::string_view(data.data(), n), seed);
+    }
+
+
+    namespace wy {
+        constexpr uint64_t kSecret[4] = {0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL, 0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL};
+
+        // The full 128 bit product of a and b, low half in a and high half in b
+        constexpr void mum(uint64_t* a, uint64_t* b) {
+#if defined(__SIZEOF_INT128__)
+            __uint128_t r = static_cast<__uint128_t>(*a) * *b;
+            *a = static_cast<uint64_t>(r);
+            *b = static_cast<uint64_t>(r >> 64);
+#else
+            uint64_t ha = *a >> 32, hb = *b >> 32, la = static_cast<uint32_t>(*a), lb = static_cast<uint32_t>(*b);
+            uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t = rl + (rm0 << 32);
+            uint64_t c = t < rl;
+            uint64_t lo = t + (rm1 << 32);
+            c += lo < t;
+            uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+            *a = lo;
+            *b = hi;
+#endif
+        }
+        constexpr uint64_t mix(uint64_t a, uint64_t b) {
+            mum(&a, &b);
+            return a ^ b;
+        }
+        constexpr uint64_t read3(const char* p, size_t k) { // 1 to 3 bytes
+            return (static_cast<uint64_t>(static_cast<uint8_t>(p[0])) << 16)
+                | (static_cast<uint64_t>(static_cast<uint8_t>(p[k >> 1])) << 8) | static_cast<uint8_t>(p[k - 1]);
+        }
+    }
+
+    /**
+     * @brief Calculates a wyhash (final version 4) hash value for the given data.
+     *
+     * It consumes 16 or 48 bytes per step with 64x64->128 bit multiplies, so it is several
+     * times faster than the byte at a time hashes above and has 64 well mixed bits.
+     *
+     * @param data The input data, it does not need to be aligned.
+     * @param n The length of the input data.
+     * @param seed The initial seed value for the hash calculation.
+     * @return The calculated 64 bit hash value.
+     */
+    constexpr uint64_t WyHash64(std::string_view data, uint64_t seed = 0) {
+        const char* p = data.data();
+        const size_t n = data.size();
+        const uint64_t* secret = wy::kSecret;
+        seed ^= wy::mix(seed ^ secret[0], secret[1]);
+        uint64_t a;
+        uint64_t b;
+        if (n <= 16) {
+            if (n >= 4) {
+                a = (static_cast<uint64_t>(LoadFixed32(p)) << 32) | LoadFixed32(p + ((n >> 3) << 2));
+                b = (static_cast<uint64_t>(LoadFixed32(p + n - 4)) << 32) | LoadFixed32(p + n - 4 - ((n >> 3) << 2));
+            }
+            else if (n > 0) {
+                a = wy::read3(p, n);
+                b = 0;
+            }
+            else {
+                a = b = 0;
+            }
+        }
+        else {
+            size_t i = n;
+            if (i > 48) {
+                uint64_t see1 = seed;
+                uint64_t see2 = seed;
+                do {
+                    seed = wy::mix(LoadFixed64(p) ^ secret[1], LoadFixed64(p + 8) ^ seed);
+                    see1 = wy::mix(LoadFixed64(p + 16) ^ secret[2], LoadFixed64(p + 24) ^ see1);
+                    see2 = wy::mix(LoadFixed64(p + 32) ^ secret[3], LoadFixed64(p + 40) ^ see2);
+                    p += 48;
+                    i -= 48;
+                } while (i > 48);
+                seed ^= see1 ^ see2;
+            }
+            while (i > 16) {
+                seed = wy::mix(LoadFixed64(p) ^ secret[1], LoadFixed64(p + 8) ^ seed);
+                i -= 16;
+                p += 16;
+            }
+            a = LoadFixed64(p + i - 16);
+            b = LoadFixed64(p + i - 8);
+        }
+        a ^= secret[1];
+        b ^= seed;
+        wy::mum(&a, &b);
+        return wy::mix(a ^ secret[0] ^ n, b ^ secret[1]);
+    }
+
+    inline uint64_t WyHash64(const void* data, size_t n, uint64_t seed = 0) {
+        return WyHash64(std::string_view(static_cast<const char*>(data), n), seed);
+    }
+
+    // Adapts WyHash64 to the Hash requirement of the standard containers
+    struct WyHasher {
+        constexpr size_t operator()(std::string_view key) const {
+            return static_cast<size_t>(WyHash64(key));
+        }
+    };
+
+    namespace crc32c {
+        constexpr uint32_t kPoly = 0x82f63b78; // The Castagnoli polynomial, bit reversed
+        constexpr uint32_t kMaskDelta = 0xa282ead8;
+
+        // Slicing-by-8 tables: kTable[k][b] is the CRC of byte b followed by k zero bytes
+        struct Tables {
+            uint32_t t[8][256];
+        };
+        constexpr Tables makeTables() {
+            Tables tables{};
+            for (uint32_t b = 0; b < 256; b++) {
+                uint32_t crc = b;
+                for (int i = 0; i < 8; i++) {
+                    crc = (crc >> 1) ^ (kPoly & (0 - (crc & 1)));
+                }
+                tables.t[0][b] = crc;
+            }
+            for (uint32_t b = 0; b < 256; b++) {
+                for (int k = 1; k < 8; k++) {
+                    tables.t[k][b] = (tables.t[k - 1][b] >> 8) ^ tables.t[0][tables.t[k - 1][b] & 0xff];
+                }
+            }
+            return tables;
+        }
+        inline constexpr Tables kTables = makeTables();
+
+        // a * b modulo the polynomial, both in the bit reversed form of the CRC register
+        constexpr uint32_t multModP(uint32_t a, uint32_t b) {
+            uint32_t product = 0;
+            for (uint32_t m = 1u << 31; m != 0; m >>= 1) {
+                if (a & m) {
+                    product ^= b;
+                }
+                b = (b >> 1) ^ (kPoly & (0 - (b & 1)));
+            }
+            return product;
+        }
+
+        // x^(8n) modulo the polynomial, multiplying a CRC register by it appends n zero bytes
+        constexpr uint32_t zeroBytesOperator(size_t n) {
+            uint32_t power = 1u << 31; // x^0
+            uint32_t square = 1u << 23; // x^8
+            for (; n != 0; n >>= 1) {
+                if (n & 1) {
+                    power = multModP(square, power);
+                }
+                square = multModP(square, square);
+            }
+            return power;
+        }
+
+        // A byte at a time, for constant expressions
+        constexpr uint32_t extendBytes(uint32_t crc, std::string_view data) {
+            for (char c : data) {
+                crc = (crc >> 8) ^ kTables.t[0][(crc ^ static_cast<uint8_t>(c)) & 0xff];
+            }
+            return crc;
+        }
+
+        inline uint32_t extendPortable(uint32_t crc, const uint8_t* p, size_t n) {
+            const auto& t = kTables.t;
+            for (; n != 0 && (reinterpret_cast<uintptr_t>(p) & 7) != 0; n--) {
+                crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xff];
+            }
+            for (; n >= 8; n -= 8, p += 8) {
+                uint32_t low = LoadFixed32(p) ^ crc;
+                uint32_t high = LoadFixed32(p + 4);
+                crc = t[7][low & 0xff] ^ t[6][(low >> 8) & 0xff] ^ t[5][(low >> 16) & 0xff] ^ t[4][low >> 24]
+                    ^ t[3][high & 0xff] ^ t[2][(high >> 8) & 0xff] ^ t[1][(high >> 16) & 0xff] ^ t[0][high >> 24];
+            }
+            for (; n != 0; n--) {
+                crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xff];
+            }
+            return crc;
+        }
+
+#if defined(ORANGEKV_CRC32C_X86)
+        /*
+         * The crc32 instruction has a latency of 3 cycles but can start one every cycle, so
+         * long buffers are cut into three streams that are checksummed side by side and then
+         * joined by shifting the earlier streams over the later ones. A shift is a product
+         * with a constant, which is linear in the CRC, so it is looked up a byte at a time in
+         * tables built at compile time rather than multiplied a bit at a time.
+         */
+        constexpr size_t kLongBlock = 8192;
+        constexpr size_t kShortBlock = 256;
+
+        // kShift.t[k][b] is multModP(shift, b << 8k), so a shift takes four lookups
+        struct ShiftTable {
+            uint32_t t[4][256];
+        };
+        constexpr ShiftTable makeShiftTable(size_t zeroBytes) {
+            uint32_t shift = zeroBytesOperator(zeroBytes);
+            ShiftTable table{};
+            for (int k = 0; k < 4; k++) {
+                for (uint32_t b = 0; b < 256; b++) {
+                    table.t[k][b] = multModP(shift, b << (8 * k));
+                }
+            }
+            return table;
+        }
+        inline constexpr ShiftTable kLongShift = makeShiftTable(kLongBlock);
+        inline constexpr ShiftTable kShortShift = makeShiftTable(kShortBlock);
+
+        inline uint32_t shift(const ShiftTable& table, uint32_t crc) {
+            return table.t[0][crc & 0xff] ^ table.t[1][(crc >> 8) & 0xff] ^ table.t[2][(crc >> 16) & 0xff] ^ table.t[3][crc >> 24];
+        }
+
+        __attribute__((target("sse4.2"))) inline void extend3Way(uint64_t& crc, const uint8_t*& p, size_t& n, size_t block, const ShiftTable& table) {
+            while (n >= 3 * block) {
+                uint64_t crc0 = crc;
+                uint64_t crc1 = 0;
+                uint64_t crc2 = 0;
+                for (size_t i = 0; i < block; i += 8) {
+                    crc0 = _mm_crc32_u64(crc0, LoadFixed64(p + i));
+                    crc1 = _mm_crc32_u64(crc1, LoadFixed64(p + block + i));
+                    crc2 = _mm_crc32_u64(crc2, LoadFixed64(p + 2 * block + i));
+                }
+                crc = shift(table, static_cast<uint32_t>(crc0)) ^ crc1;
+                crc = shift(table, static_cast<uint32_t>(crc)) ^ crc2;
+                p += 3 * block;
+                n -= 3 * block;
+            }
+        }
+
+        __attribute__((target("sse4.2"))) inline uint32_t extendSse42(uint32_t crc32, const uint8_t* p, size_t n) {
+            uint64_t crc = crc32;
+            for (; n != 0 && (reinterpret_cast<uintptr_t>(p) & 7) != 0; n--) {
+                crc = _mm_crc32_u8(static_cast<uint32_t>(crc), *p++);
+            }
+            extend3Way(crc, p, n, kLongBlock, kLongShift);
+            extend3Way(crc, p, n, kShortBlock, kShortShift);
+            for (; n >= 8; n -= 8, p += 8) {
+                crc = _mm_crc32_u64(crc, LoadFixed64(p));
+            }
+            for (; n != 0; n--) {
+                crc = _mm_crc32_u8(static_cast<uint32_t>(crc), *p++);
+            }
+            return static_cast<uint32_t>(crc);
+        }
+#endif
+
+        using ExtendFunction = uint32_t (*)(uint32_t crc, const uint8_t* p, size_t n);
+
+        inline ExtendFunction selectExtend() {
+#if defined(ORANGEKV_CRC32C_X86)
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("sse4.2")) {
+                return &extendSse42;
+            }
+#endif
+            return &extendPortable;
+        }
+
+        inline ExtendFunction extendFunction() {
+            static const ExtendFunction function = selectExtend();
+            return function;
+        }
+    }
+
+    /**
+     * @brief Extends a CRC32C with more data.
+     *
+     * Uses the SSE4.2 crc32 instruction when the CPU has it and a table driven loop otherwise.
+     *
+     * @param crc The CRC32C of the data before, 0 for none.
+     * @param data The input data, it does not need to be aligned.
+     * @param n The length of the input data.
+     * @return The CRC32C of the data before followed by this data.
+     */
+    inline uint32_t Crc32cExtend(uint32_t crc, const void* data, size_t n) {
+        return ~crc32c::extendFunction()(~crc, static_cast<const uint8_t*>(data), n);
+    }
+
+    /**
+     * @brief Calculates the CRC32C (Castagnoli) checksum of the given data.
+     *
+     * @param data The input data, it does not need to be aligned.
+     * @param n The length of the input data.
+     * @return The calculated CRC32C.
+     */
+    inline uint32_t Crc32c(const void* data, size_t n) {
+        return Crc32cExtend(0, data, n);
+    }
+
+    constexpr uint32_t Crc32cExtend(uint32_t crc, std::string_view data) {
+        if (std::is_constant_evaluated()) {
+            return ~crc32c::extendBytes(~crc, data);
+        }
+        return Crc32cExtend(crc, data.data(), data.size());
+    }
+
+    constexpr uint32_t Crc32c(std::string_view data) {
+        return Crc32cExtend(0, data);
+    }
+
+    /**
+     * @brief Masks a CRC32C before it is stored.
+     *
+     * The CRC of a string that contains its own CRC is a poor checksum, which happens when
+     * checksummed blocks are embedded in other checksummed data, so stored CRCs are rotated
+     * and offset first. This is the masking of the LevelDB log and table formats.
+     *
+     * @param crc The CRC32C to store.
+     * @return The masked CRC32C.
+     */
+    constexpr uint32_t MaskCrc32c(uint32_t crc) {
+        return ((crc >> 15) | (crc << 17)) + crc32c::kMaskDelta;
+    }
+
+    // Undoes MaskCrc32c on a stored CRC32C
+    constexpr uint32_t UnmaskCrc32c(uint32_t masked) {
+        uint32_t rot = masked - crc32c::kMaskDelta;
+        return (rot >> 17) | (rot << 15);
+    }
+
+    namespace literals {
+        /**
+         * @brief Hashes a string literal at compile time, "get"_hash == MurmurHash3_x86_32("get").
+         *
+         * It is consteval so the hash of a fixed key is never computed at runtime, which lets
+         * the keys be case labels: switch (MurmurHash3_x86_32(command)) { case "get"_hash: ... }.
+         * Two keys with the same hash are duplicate case labels, so collisions fail to compile;
+         * the input still has to be compared with the key after the match.
+         */
+        consteval uint32_t operator""_hash(const char* data, size_t n) {
+            return MurmurHash3_x86_32(std::string_view(data, n));
+        }
     }
 } // End of namespace
 #endif // HASH_HPP
\ No newline at end of file
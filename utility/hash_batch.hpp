@@ -0,0 +1,221 @@
+#ifndef HASH_BATCH_HPP
+#define HASH_BATCH_HPP
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <string_view>
+#include "utility/hash.hpp"
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define ORANGEKV_HASH_BATCH_X86 1
+#include <immintrin.h>
+#endif
+/*
+ * Hashing many keys at once. Each SIMD lane runs MurmurHash3_x86_32 on its own key, so the
+ * multiply and rotate chains of 8 (AVX2) or 16 (AVX-512) keys run side by side. Lanes whose
+ * key has run out of 4 byte blocks keep their hash unchanged, so keys of different lengths
+ * can share a batch. The results are bit for bit the same as the scalar function; the kernel
+ * is picked once at runtime from what the CPU supports.
+ */
+namespace OrangeKV {
+    namespace batch {
+        constexpr uint32_t kC1 = 0xcc9e2d51;
+        constexpr uint32_t kC2 = 0x1b873593;
+        constexpr uint32_t kN1 = 0xe6546b64;
+
+        // The last 1 to 3 bytes of a key, mixed the way MurmurHash3_x86_32 mixes its tail
+        inline uint32_t murmur32Tail(std::string_view key) {
+            const uint8_t* tail = reinterpret_cast<const uint8_t*>(key.data() + (key.size() & ~static_cast<size_t>(3)));
+            uint32_t k1 = 0;
+            switch (key.size() & 3) {
+                case 3:
+                    k1 ^= tail[2] << 16;
+                    [[fallthrough]];
+                case 2:
+                    k1 ^= tail[1] << 8;
+                    [[fallthrough]];
+                case 1:
+                    k1 ^= tail[0];
+            }
+            return k1;
+        }
+
+        inline void murmur32Scalar(const std::string_view* keys, size_t n, uint32_t seed, uint32_t* out) {
+            for (size_t i = 0; i < n; i++) {
+                out[i] = MurmurHash3_x86_32(keys[i].data(), keys[i].size(), seed);
+            }
+        }
+
+#if defined(ORANGEKV_HASH_BATCH_X86)
+        __attribute__((target("avx2"))) inline __m256i rotl32x8(__m256i x, int r) {
+            return _mm256_or_si256(_mm256_slli_epi32(x, r), _mm256_srli_epi32(x, 32 - r));
+        }
+
+        __attribute__((target("avx2"))) inline void murmur32Avx2(const std::string_view* keys, size_t n, uint32_t seed, uint32_t* out) {
+            constexpr size_t kLanes = 8;
+            const __m256i c1 = _mm256_set1_epi32(static_cast<int>(kC1));
+            const __m256i c2 = _mm256_set1_epi32(static_cast<int>(kC2));
+            const __m256i n1 = _mm256_set1_epi32(static_cast<int>(kN1));
+            const __m256i five = _mm256_set1_epi32(5);
+            const __m256i step = _mm256_set1_epi64x(4);
+            size_t i = 0;
+            for (; i + kLanes <= n; i += kLanes) {
+                const std::string_view* g = keys + i;
+                size_t maxBlocks = 0;
+                for (size_t lane = 0; lane < kLanes; lane++) {
+                    maxBlocks = std::max(maxBlocks, g[lane].size() / 4);
+                }
+                const __m256i blockCount = _mm256_setr_epi32(
+                    static_cast<int>(g[0].size() / 4), static_cast<int>(g[1].size() / 4), static_cast<int>(g[2].size() / 4), static_cast<int>(g[3].size() / 4),
+                    static_cast<int>(g[4].size() / 4), static_cast<int>(g[5].size() / 4), static_cast<int>(g[6].size() / 4), static_cast<int>(g[7].size() / 4));
+                // The address of the next block of each key, gathered from with a null base
+                __m256i addrLo = _mm256_setr_epi64x(reinterpret_cast<long long>(g[0].data()), reinterpret_cast<long long>(g[1].data()),
+                                                    reinterpret_cast<long long>(g[2].data()), reinterpret_cast<long long>(g[3].data()));
+                __m256i addrHi = _mm256_setr_epi64x(reinterpret_cast<long long>(g[4].data()), reinterpret_cast<long long>(g[5].data()),
+                                                    reinterpret_cast<long long>(g[6].data()), reinterpret_cast<long long>(g[7].data()));
+                __m256i h = _mm256_set1_epi32(static_cast<int>(seed));
+                for (size_t b = 0; b < maxBlocks; b++) {
+                    __m256i active = _mm256_cmpgt_epi32(blockCount, _mm256_set1_epi32(static_cast<int>(b)));
+                    __m128i kLo = _mm256_mask_i64gather_epi32(_mm_setzero_si128(), nullptr, addrLo, _mm256_castsi256_si128(active), 1);
+                    __m128i kHi = _mm256_mask_i64gather_epi32(_mm_setzero_si128(), nullptr, addrHi, _mm256_extracti128_si256(active, 1), 1);
+                    addrLo = _mm256_add_epi64(addrLo, step);
+                    addrHi = _mm256_add_epi64(addrHi, step);
+                    __m256i k = _mm256_inserti128_si256(_mm256_castsi128_si256(kLo), kHi, 1);
+                    k = _mm256_mullo_epi32(k, c1);
+                    k = rotl32x8(k, 15);
+                    k = _mm256_mullo_epi32(k, c2);
+                    __m256i mixed = _mm256_xor_si256(h, k);
+                    mixed = _mm256_add_epi32(_mm256_mullo_epi32(rotl32x8(mixed, 13), five), n1);
+                    h = _mm256_blendv_epi8(h, mixed, active);
+                }
+                __m256i k1 = _mm256_setr_epi32(
+                    static_cast<int>(murmur32Tail(g[0])), static_cast<int>(murmur32Tail(g[1])), static_cast<int>(murmur32Tail(g[2])), static_cast<int>(murmur32Tail(g[3])),
+                    static_cast<int>(murmur32Tail(g[4])), static_cast<int>(murmur32Tail(g[5])), static_cast<int>(murmur32Tail(g[6])), static_cast<int>(murmur32Tail(g[7])));
+                k1 = _mm256_mullo_epi32(k1, c1); // A key without a tail has k1 = 0, which stays 0
+                k1 = rotl32x8(k1, 15);
+                k1 = _mm256_mullo_epi32(k1, c2);
+                h = _mm256_xor_si256(h, k1);
+                h = _mm256_xor_si256(h, _mm256_setr_epi32(
+                    static_cast<int>(g[0].size()), static_cast<int>(g[1].size()), static_cast<int>(g[2].size()), static_cast<int>(g[3].size()),
+                    static_cast<int>(g[4].size()), static_cast<int>(g[5].size()), static_cast<int>(g[6].size()), static_cast<int>(g[7].size())));
+                h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+                h = _mm256_mullo_epi32(h, _mm256_set1_epi32(static_cast<int>(0x85ebca6b)));
+                h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 13));
+                h = _mm256_mullo_epi32(h, _mm256_set1_epi32(static_cast<int>(0xc2b2ae35)));
+                h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), h);
+            }
+            murmur32Scalar(keys + i, n - i, seed, out + i);
+        }
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized" // GCC 12 flags the undefined vectors inside its own AVX-512 intrinsics
+#endif
+        __attribute__((target("avx512f"))) inline void murmur32Avx512(const std::string_view* keys, size_t n, uint32_t seed, uint32_t* out) {
+            constexpr size_t kLanes = 16;
+            const __m512i c1 = _mm512_set1_epi32(static_cast<int>(kC1));
+            const __m512i c2 = _mm512_set1_epi32(static_cast<int>(kC2));
+            const __m512i n1 = _mm512_set1_epi32(static_cast<int>(kN1));
+            const __m512i five = _mm512_set1_epi32(5);
+            const __m512i step = _mm512_set1_epi64(4);
+            size_t i = 0;
+            for (; i + kLanes <= n; i += kLanes) {
+                const std::string_view* g = keys + i;
+                size_t maxBlocks = 0;
+                for (size_t lane = 0; lane < kLanes; lane++) {
+                    maxBlocks = std::max(maxBlocks, g[lane].size() / 4);
+                }
+                if (maxBlocks < 4) { // Too little work to pay for setting up the lanes
+                    murmur32Scalar(g, kLanes, seed, out + i);
+                    continue;
+                }
+                auto blocksOf = [g](size_t lane) { return static_cast<int>(g[lane].size() / 4); };
+                auto lengthOf = [g](size_t lane) { return static_cast<int>(g[lane].size()); };
+                auto tailOf = [g](size_t lane) { return static_cast<int>(murmur32Tail(g[lane])); };
+                auto addressOf = [g](size_t lane) { return reinterpret_cast<long long>(g[lane].data()); };
+                const __m512i blockCount = _mm512_setr_epi32(blocksOf(0), blocksOf(1), blocksOf(2), blocksOf(3), blocksOf(4), blocksOf(5), blocksOf(6), blocksOf(7),
+                                                             blocksOf(8), blocksOf(9), blocksOf(10), blocksOf(11), blocksOf(12), blocksOf(13), blocksOf(14), blocksOf(15));
+                const __m512i lengths = _mm512_setr_epi32(lengthOf(0), lengthOf(1), lengthOf(2), lengthOf(3), lengthOf(4), lengthOf(5), lengthOf(6), lengthOf(7),
+                                                          lengthOf(8), lengthOf(9), lengthOf(10), lengthOf(11), lengthOf(12), lengthOf(13), lengthOf(14), lengthOf(15));
+                __m512i k1 = _mm512_setr_epi32(tailOf(0), tailOf(1), tailOf(2), tailOf(3), tailOf(4), tailOf(5), tailOf(6), tailOf(7),
+                                               tailOf(8), tailOf(9), tailOf(10), tailOf(11), tailOf(12), tailOf(13), tailOf(14), tailOf(15));
+                __m512i addrLo = _mm512_setr_epi64(addressOf(0), addressOf(1), addressOf(2), addressOf(3), addressOf(4), addressOf(5), addressOf(6), addressOf(7));
+                __m512i addrHi = _mm512_setr_epi64(addressOf(8), addressOf(9), addressOf(10), addressOf(11), addressOf(12), addressOf(13), addressOf(14), addressOf(15));
+                __m512i h = _mm512_set1_epi32(static_cast<int>(seed));
+                for (size_t b = 0; b < maxBlocks; b++) {
+                    __mmask16 active = _mm512_cmpgt_epi32_mask(blockCount, _mm512_set1_epi32(static_cast<int>(b)));
+                    __m256i kLo = _mm512_mask_i64gather_epi32(_mm256_setzero_si256(), static_cast<__mmask8>(active), addrLo, nullptr, 1);
+                    __m256i kHi = _mm512_mask_i64gather_epi32(_mm256_setzero_si256(), static_cast<__mmask8>(active >> 8), addrHi, nullptr, 1);
+                    addrLo = _mm512_add_epi64(addrLo, step);
+                    addrHi = _mm512_add_epi64(addrHi, step);
+                    __m512i k = _mm512_inserti64x4(_mm512_castsi256_si512(kLo), kHi, 1);
+                    k = _mm512_mullo_epi32(k, c1);
+                    k = _mm512_rol_epi32(k, 15);
+                    k = _mm512_mullo_epi32(k, c2);
+                    __m512i mixed = _mm512_xor_si512(h, k);
+                    mixed = _mm512_add_epi32(_mm512_mullo_epi32(_mm512_rol_epi32(mixed, 13), five), n1);
+                    h = _mm512_mask_mov_epi32(h, active, mixed);
+                }
+                k1 = _mm512_mullo_epi32(k1, c1);
+                k1 = _mm512_rol_epi32(k1, 15);
+                k1 = _mm512_mullo_epi32(k1, c2);
+                h = _mm512_xor_si512(h, k1);
+                h = _mm512_xor_si512(h, lengths);
+                h = _mm512_xor_si512(h, _mm512_srli_epi32(h, 16));
+                h = _mm512_mullo_epi32(h, _mm512_set1_epi32(static_cast<int>(0x85ebca6b)));
+                h = _mm512_xor_si512(h, _mm512_srli_epi32(h, 13));
+                h = _mm512_mullo_epi32(h, _mm512_set1_epi32(static_cast<int>(0xc2b2ae35)));
+                h = _mm512_xor_si512(h, _mm512_srli_epi32(h, 16));
+                _mm512_storeu_si512(out + i, h);
+            }
+            murmur32Scalar(keys + i, n - i, seed, out + i);
+        }
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#endif
+
+        using Murmur32BatchFunction = void (*)(const std::string_view* keys, size_t n, uint32_t seed, uint32_t* out);
+
+        struct Murmur32Kernel {
+            Murmur32BatchFunction function;
+            const char* name;
+        };
+
+        inline Murmur32Kernel selectMurmur32Kernel() {
+#if defined(ORANGEKV_HASH_BATCH_X86)
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512f")) {
+                return {&murmur32Avx512, "avx512"};
+            }
+            if (__builtin_cpu_supports("avx2")) {
+                return {&murmur32Avx2, "avx2"};
+            }
+#endif
+            return {&murmur32Scalar, "scalar"};
+        }
+
+        inline const Murmur32Kernel& murmur32Kernel() {
+            static const Murmur32Kernel kernel = selectMurmur32Kernel();
+            return kernel;
+        }
+    }
+
+    /**
+     * @brief Calculates MurmurHash3_x86_32 for many keys at once.
+     *
+     * @param keys The input keys.
+     * @param n The number of keys.
+     * @param seed The initial seed value for the hash calculation.
+     * @param out Receives the n hash values, out[i] == MurmurHash3_x86_32(keys[i], seed).
+     */
+    inline void MurmurHash3_x86_32_Batch(const std::string_view* keys, size_t n, uint32_t seed, uint32_t* out) {
+        batch::murmur32Kernel().function(keys, n, seed, out);
+    }
+
+    // The name of the kernel MurmurHash3_x86_32_Batch runs on this CPU: "avx512", "avx2" or "scalar"
+    inline const char* MurmurHash3_x86_32_BatchKernel() {
+        return batch::murmur32Kernel().name;
+    }
+}
+#endif // HASH_BATCH_HPP
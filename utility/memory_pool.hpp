@@ -1,21 +1,335 @@
 #ifndef MEMORY_POOL_HPP
 #define MEMORY_POOL_HPP
 
-// Include any necessary headers here
-#include <iostream>
+#include <atomic>
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <new>
+#include <thread>
 #include <vector>
 #include <memory>
+#include <cstdint>
+#include <cstddef>
+#include "utility/page_allocator.hpp"
+#include "utility/memory_report.hpp"
+/*
+ * An arena: memory is bump allocated from blocks and only returned, all at once, when the
+ * pool is destroyed. Objects that live and die together (the entries of a write buffer, the
+ * scratch of a request) cost a pointer bump each instead of a malloc and a free. Requests
+ * larger than a quarter of a block get a block of their own, so they don't waste the rest of
+ * the current one. With PageOptions the blocks are mapped on huge pages and/or a NUMA node,
+ * see utility/page_allocator.hpp; huge pages round the block size up to a huge page.
+ */
 namespace OrangeKV {
     class MemoryPool {
     public:
+        static constexpr size_t kBlockSize = 4096;
+        static constexpr size_t kAlignment = alignof(std::max_align_t) > sizeof(void*) ? alignof(std::max_align_t) : sizeof(void*);
+
         MemoryPool();
+        explicit MemoryPool(size_t blockSize, const PageOptions& pageOptions = {});
         MemoryPool(const MemoryPool&) = delete;
         MemoryPool& operator=(const MemoryPool&) = delete;
         ~MemoryPool();
-    private:
+
+        // Return a pointer to bytes bytes, which live as long as the pool
         char* allocate(size_t bytes);
+        // Like allocate, aligned to kAlignment
+        char* allocateAligned(size_t bytes);
+        // Get the memory held by the pool, safe to call while another thread allocates
+        size_t memoryUsage() const {
+            return memoryUsage_.load(std::memory_order_relaxed);
+        }
+        // Add the blocks and the bytes handed out of them, only from the thread that allocates
+        void reportMemory(MemoryReport& report, std::string_view name) const;
+    private:
+        char* allocateFallback(size_t bytes);
+        char* allocateNewBlock(size_t blockBytes);
+
+        struct Block {
+            char* data;
+            size_t size;
+            size_t mapped; // The size of the mapping, 0 if the block is from new[]
+        };
+
+        size_t blockSize;
+        PageOptions pageOptions;
+        char* allocPtr; // The free part of the current block
+        size_t allocBytesRemaining;
+        size_t wasted = 0; // The free tails of the blocks that were replaced
+        std::vector<Block> blocks;
+        std::atomic<size_t> memoryUsage_;
     };
+
+    inline MemoryPool::MemoryPool() : MemoryPool(kBlockSize) {}
+
+    inline MemoryPool::MemoryPool(size_t blockSize, const PageOptions& pageOptions)
+        : blockSize(std::max(blockSize, kAlignment)), pageOptions(pageOptions), allocPtr(nullptr), allocBytesRemaining(0), memoryUsage_(0) {
+        if (pageOptions.hugePages != HugePages::kNone) {
+            this->blockSize = pages::roundUp(this->blockSize, pages::kHugePageSize);
+        }
+    }
+
+    inline MemoryPool::~MemoryPool() {
+        for (const Block& block : blocks) {
+            if (block.mapped > 0) {
+                pages::unmap(block.data, block.mapped);
+            }
+            else {
+                delete[] block.data;
+            }
+        }
+    }
+
+    inline char* MemoryPool::allocate(size_t bytes) {
+        assert(bytes > 0);
+        if (bytes <= allocBytesRemaining) {
+            char* result = allocPtr;
+            allocPtr += bytes;
+            allocBytesRemaining -= bytes;
+            return result;
+        }
+        return allocateFallback(bytes);
+    }
+
+    inline char* MemoryPool::allocateAligned(size_t bytes) {
+        static_assert((kAlignment & (kAlignment - 1)) == 0, "kAlignment must be a power of 2");
+        size_t mod = reinterpret_cast<uintptr_t>(allocPtr) & (kAlignment - 1);
+        size_t slop = mod == 0 ? 0 : kAlignment - mod;
+        size_t needed = bytes + slop;
+        char* result;
+        if (needed <= allocBytesRemaining) {
+            result = allocPtr + slop;
+            allocPtr += needed;
+            allocBytesRemaining -= needed;
+        }
+        else {
+            result = allocateFallback(bytes); // new[] and mmap return memory aligned for any type
+        }
+        assert((reinterpret_cast<uintptr_t>(result) & (kAlignment - 1)) == 0);
+        return result;
+    }
+
+    inline char* MemoryPool::allocateFallback(size_t bytes) {
+        if (bytes > blockSize / 4) { // A block of its own, the current block keeps its free space
+            return allocateNewBlock(bytes);
+        }
+        wasted += allocBytesRemaining;
+        allocPtr = allocateNewBlock(blockSize);
+        allocBytesRemaining = blockSize;
+        char* result = allocPtr;
+        allocPtr += bytes;
+        allocBytesRemaining -= bytes;
+        return result;
+    }
+
+    inline char* MemoryPool::allocateNewBlock(size_t blockBytes) {
+        if (pageOptions.enabled()) {
+            size_t mapped = pages::mappedSize(blockBytes, pageOptions);
+            auto* result = static_cast<char*>(pages::map(mapped, pageOptions));
+            if (result != nullptr) {
+                blocks.push_back(Block{result, blockBytes, mapped});
+                memoryUsage_.fetch_add(mapped + sizeof(Block), std::memory_order_relaxed);
+                return result;
+            }
+        }
+        char* result = new char[blockBytes];
+        blocks.push_back(Block{result, blockBytes, 0});
+        memoryUsage_.fetch_add(blockBytes + sizeof(Block), std::memory_order_relaxed);
+        return result;
+    }
+
+    inline void MemoryPool::reportMemory(MemoryReport& report, std::string_view name) const {
+        size_t handedOut = 0;
+        for (const Block& block : blocks) {
+            handedOut += block.size;
+        }
+        handedOut -= wasted + allocBytesRemaining;
+        report.add(std::string(name) + ".blocks", memoryUsage() + (blocks.capacity() - blocks.size()) * sizeof(Block), handedOut);
+    }
+
+    /*
+     * A MemoryPool that many threads can allocate from at once without locks. Every thread
+     * bump allocates from the block of its own shard with an atomic add, which no other thread
+     * touches unless there are more threads than shards. Objects too big for the shard blocks
+     * come from one shared block the same way, and the biggest get a block of their own. A
+     * full block is replaced by a compare and swap; the thread that loses the race frees the
+     * block it made and retries on the winner's. With huge pages every block, the shard blocks
+     * too, is a whole number of huge pages, and PageOptions::kLocalNode puts the block of a
+     * shard on the node of the thread that filled it.
+     */
+    class ConcurrentMemoryPool {
+    public:
+        static constexpr size_t kBlockSize = 64 * 1024;
+        static constexpr size_t kAlignment = MemoryPool::kAlignment;
+
+        ConcurrentMemoryPool();
+        explicit ConcurrentMemoryPool(size_t blockSize, const PageOptions& pageOptions = {});
+        ConcurrentMemoryPool(const ConcurrentMemoryPool&) = delete;
+        ConcurrentMemoryPool& operator=(const ConcurrentMemoryPool&) = delete;
+        ~ConcurrentMemoryPool();
+
+        char* allocate(size_t bytes) {
+            return allocateFrom(bytes, false);
+        }
+        char* allocateAligned(size_t bytes) {
+            return allocateFrom(bytes, true);
+        }
+        size_t memoryUsage() const { // Get the memory of every block, including the unused tails
+            return memoryUsage_.load(std::memory_order_relaxed);
+        }
+        // Add the blocks and the bytes handed out of them, from any thread
+        void reportMemory(MemoryReport& report, std::string_view name) const {
+            size_t handedOut = 0;
+            for (Block* block = blocks.load(std::memory_order_acquire); block != nullptr; block = block->next) {
+                size_t used = block->used.load(std::memory_order_relaxed);
+                handedOut += used <= block->capacity ? used : block->end.load(std::memory_order_relaxed);
+            }
+            report.add(std::string(name) + ".blocks", memoryUsage(), handedOut);
+        }
+    private:
+        struct alignas(kAlignment) Block {
+            Block* next; // The block linked before it
+            size_t capacity;
+            size_t mapped; // The size of the mapping, 0 if the block is from operator new
+            std::atomic<size_t> used;
+            std::atomic<size_t> end; // The end of the last allocation, once used went past capacity
+
+            char* data() {
+                return reinterpret_cast<char*>(this + 1);
+            }
+            // nullptr if the block is full, a failed add leaves used past capacity so later ones fail too
+            char* tryAllocate(size_t bytes, bool aligned) {
+                if (!aligned) {
+                    size_t offset = used.fetch_add(bytes, std::memory_order_relaxed);
+                    if (offset + bytes <= capacity) {
+                        return data() + offset;
+                    }
+                    if (offset <= capacity) { // The one add that crossed capacity, every earlier add fit
+                        end.store(offset, std::memory_order_relaxed);
+                    }
+                    return nullptr;
+                }
+                size_t current = used.load(std::memory_order_relaxed);
+                size_t offset;
+                do {
+                    offset = (current + kAlignment - 1) & ~(kAlignment - 1);
+                    if (offset + bytes > capacity) {
+                        return nullptr;
+                    }
+                } while (!used.compare_exchange_weak(current, offset + bytes, std::memory_order_relaxed));
+                return data() + offset;
+            }
+        };
+
+        struct alignas(64) Shard { // A cache line each, so shards don't false share
+            std::atomic<Block*> current{nullptr};
+        };
+
+        static size_t threadIndex() { // A number per thread, handed out in turn
+            static std::atomic<size_t> next{0};
+            thread_local size_t index = next.fetch_add(1, std::memory_order_relaxed);
+            return index;
+        }
+
+        Block* newBlock(size_t capacity) const {
+            if (pageOptions.enabled()) {
+                size_t mapped = pages::mappedSize(sizeof(Block) + capacity, pageOptions);
+                void* memory = pages::map(mapped, pageOptions);
+                if (memory != nullptr) {
+                    return new (memory) Block{nullptr, mapped - sizeof(Block), mapped, {0}, {mapped - sizeof(Block)}};
+                }
+            }
+            void* memory = ::operator new(sizeof(Block) + capacity);
+            return new (memory) Block{nullptr, capacity, 0, {0}, {capacity}};
+        }
+        static void deleteBlock(Block* block) {
+            size_t mapped = block->mapped;
+            block->~Block();
+            if (mapped > 0) {
+                pages::unmap(block, mapped);
+            }
+            else {
+                ::operator delete(block);
+            }
+        }
+        void link(Block* block) {
+            memoryUsage_.fetch_add(sizeof(Block) + block->capacity, std::memory_order_relaxed);
+            Block* head = blocks.load(std::memory_order_relaxed);
+            do {
+                block->next = head;
+            } while (!blocks.compare_exchange_weak(head, block, std::memory_order_release, std::memory_order_relaxed));
+        }
+
+        char* allocateIn(std::atomic<Block*>& slot, size_t blockBytes, size_t bytes, bool aligned);
+        char* allocateFrom(size_t bytes, bool aligned);
+
+        size_t blockSize;
+        size_t shardBlockSize;
+        PageOptions pageOptions;
+        std::unique_ptr<Shard[]> shards;
+        size_t shardMask;
+        Shard shared;
+        std::atomic<Block*> blocks{nullptr}; // Every block, to free them
+        std::atomic<size_t> memoryUsage_{0};
+    };
+
+    inline ConcurrentMemoryPool::ConcurrentMemoryPool() : ConcurrentMemoryPool(kBlockSize) {}
+
+    inline ConcurrentMemoryPool::ConcurrentMemoryPool(size_t blockSize, const PageOptions& pageOptions)
+        : blockSize(std::max<size_t>(blockSize, 1024)), pageOptions(pageOptions) {
+        shardBlockSize = this->blockSize / 8;
+        if (pageOptions.hugePages != HugePages::kNone) { // Blocks of whole huge pages, header included
+            this->blockSize = pages::roundUp(this->blockSize + sizeof(Block), pages::kHugePageSize) - sizeof(Block);
+            shardBlockSize = pages::kHugePageSize - sizeof(Block);
+        }
+        size_t count = std::bit_ceil(std::max<size_t>(std::thread::hardware_concurrency(), 1));
+        shards = std::make_unique<Shard[]>(count);
+        shardMask = count - 1;
+    }
+
+    inline ConcurrentMemoryPool::~ConcurrentMemoryPool() {
+        Block* block = blocks.load(std::memory_order_acquire);
+        while (block != nullptr) {
+            Block* next = block->next;
+            deleteBlock(block);
+            block = next;
+        }
+    }
+
+    inline char* ConcurrentMemoryPool::allocateIn(std::atomic<Block*>& slot, size_t blockBytes, size_t bytes, bool aligned) {
+        while (true) {
+            Block* block = slot.load(std::memory_order_acquire);
+            if (block != nullptr) {
+                char* result = block->tryAllocate(bytes, aligned);
+                if (result != nullptr) {
+                    return result;
+                }
+            }
+            Block* fresh = newBlock(blockBytes);
+            char* result = fresh->tryAllocate(bytes, aligned);
+            if (slot.compare_exchange_strong(block, fresh, std::memory_order_acq_rel)) {
+                link(fresh);
+                return result;
+            }
+            deleteBlock(fresh); // Another thread replaced the block first
+        }
+    }
+
+    inline char* ConcurrentMemoryPool::allocateFrom(size_t bytes, bool aligned) {
+        assert(bytes > 0);
+        if (bytes <= shardBlockSize / 4) {
+            return allocateIn(shards[threadIndex() & shardMask].current, shardBlockSize, bytes, aligned);
+        }
+        if (bytes <= blockSize / 4) {
+            return allocateIn(shared.current, blockSize, bytes, aligned);
+        }
+        Block* block = newBlock(bytes); // The data of a block is aligned
+        block->used.store(bytes, std::memory_order_relaxed);
+        link(block);
+        return block->data();
+    }
 }
-// Define your memory pool class here
 
-#endif // MEMORY_POOL_HPP
\ No newline at end of file
+#endif // MEMORY_POOL_HPP
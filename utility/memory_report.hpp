@@ -0,0 +1,76 @@
+#ifndef MEMORY_REPORT_HPP
+#define MEMORY_REPORT_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+/*
+ * Where the memory goes. Every component that holds memory (caches, memory pools, filters)
+ * has a reportMemory(MemoryReport&, name) that adds a line per part of it, named name.part,
+ * with the bytes it took from its allocator and the bytes of them that hold data. The rest
+ * is overhead: headers, links and buckets, padding, and free space that is held but unused.
+ */
+namespace OrangeKV {
+    struct MemoryUsage {
+        std::string component;
+        size_t allocated = 0; // Bytes taken from the allocator
+        size_t used = 0; // Bytes of them that hold data
+
+        size_t overhead() const {
+            return allocated > used ? allocated - used : 0;
+        }
+    };
+
+    class MemoryReport {
+    private:
+        std::vector<MemoryUsage> lines;
+    public:
+        void add(std::string component, size_t allocated, size_t used) {
+            lines.push_back(MemoryUsage{std::move(component), allocated, used});
+        }
+        const std::vector<MemoryUsage>& components() const {
+            return lines;
+        }
+        // The sum of the components whose names start with prefix, every component by default
+        MemoryUsage total(std::string_view prefix = {}) const {
+            MemoryUsage sum{std::string(prefix), 0, 0};
+            for (const MemoryUsage& line : lines) {
+                if (line.component.compare(0, prefix.size(), prefix) == 0) {
+                    sum.allocated += line.allocated;
+                    sum.used += line.used;
+                }
+            }
+            return sum;
+        }
+        // A table of every component and the total
+        std::string toString() const {
+            std::string out;
+            char buf[256];
+            auto append = [&](const MemoryUsage& line) {
+                double percent = line.allocated == 0 ? 0 : 100.0 * line.overhead() / line.allocated;
+                std::snprintf(buf, sizeof(buf), "%-32s %14zu %14zu %14zu %6.1f%%\n", line.component.c_str(), line.allocated, line.used, line.overhead(), percent);
+                out += buf;
+            };
+            std::snprintf(buf, sizeof(buf), "%-32s %14s %14s %14s %7s\n", "component", "allocated", "used", "overhead", "");
+            out += buf;
+            for (const MemoryUsage& line : lines) {
+                append(line);
+            }
+            MemoryUsage sum = total();
+            sum.component = "total";
+            append(sum);
+            return out;
+        }
+    };
+
+    // A filter held in a string
+    inline void ReportFilterMemory(MemoryReport& report, std::string_view name, const std::string& filter) {
+        report.add(std::string(name), filter.capacity() + 1, filter.size());
+    }
+}
+
+#endif // MEMORY_REPORT_HPP
@@ -0,0 +1,134 @@
+#ifndef PAGE_ALLOCATOR_HPP
+#define PAGE_ALLOCATOR_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <new>
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+/*
+ * Memory mapped straight from the kernel for the blocks of the arenas and the slabs of the
+ * slab allocator, optionally on huge pages, to cut TLB misses, and placed on one NUMA node, to
+ * keep accesses local. Transparent huge pages are asked for with MADV_HUGEPAGE; explicit ones
+ * come from the hugetlbfs pool with MAP_HUGETLB and fall back to transparent ones when the
+ * pool is empty. A region for transparent huge pages starts on a huge page boundary. The node
+ * is set with mbind before the pages are touched, as a preference, so the kernel still falls
+ * back to other nodes rather than fail when the node is full. Only Linux has any of this;
+ * elsewhere map returns nullptr and callers use operator new.
+ */
+namespace OrangeKV {
+    enum class HugePages : uint8_t {
+        kNone,
+        kTransparent, // madvise(MADV_HUGEPAGE)
+        kExplicit, // MAP_HUGETLB, needs pages reserved in /proc/sys/vm/nr_hugepages
+    };
+
+    struct PageOptions {
+        static constexpr int kAnyNode = -1;
+        static constexpr int kLocalNode = -2; // The node of the thread that maps the memory
+
+        HugePages hugePages = HugePages::kNone;
+        int numaNode = kAnyNode;
+
+        bool enabled() const { // Whether memory has to be mapped at all
+            return hugePages != HugePages::kNone || numaNode != kAnyNode;
+        }
+    };
+
+    namespace pages {
+        constexpr size_t kPageSize = 4096;
+        constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+        inline size_t roundUp(size_t bytes, size_t unit) {
+            return (bytes + unit - 1) / unit * unit;
+        }
+
+        // The node of the CPU the thread runs on, -1 if it is unknown
+        inline int currentNode() {
+#if defined(__linux__) && defined(SYS_getcpu)
+            unsigned cpu;
+            unsigned node;
+            if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) {
+                return static_cast<int>(node);
+            }
+#endif
+            return -1;
+        }
+
+        // The size map takes for bytes, huge pages are only used for regions of whole huge pages
+        inline size_t mappedSize(size_t bytes, const PageOptions& options) {
+            if (options.hugePages != HugePages::kNone && bytes >= kHugePageSize) {
+                return roundUp(bytes, kHugePageSize);
+            }
+            return roundUp(bytes, kPageSize);
+        }
+
+        /**
+         * @brief Maps zeroed memory.
+         *
+         * @param bytes The size, which must be mappedSize of the size wanted.
+         * @return nullptr if the memory can't be mapped.
+         */
+        inline void* map(size_t bytes, const PageOptions& options) {
+#if defined(__linux__)
+            bool huge = options.hugePages != HugePages::kNone && bytes % kHugePageSize == 0;
+            void* memory = MAP_FAILED;
+#if defined(MAP_HUGETLB)
+            if (huge && options.hugePages == HugePages::kExplicit) {
+                memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            }
+#endif
+            if (memory == MAP_FAILED) {
+                // The kernel only backs huge page aligned ranges with transparent huge pages, and
+                // mmap only aligns to a page, so map a huge page more and trim it to a boundary
+                size_t slack = huge ? kHugePageSize : 0;
+                memory = mmap(nullptr, bytes + slack, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (memory == MAP_FAILED) {
+                    return nullptr;
+                }
+                if (huge) {
+                    auto start = reinterpret_cast<uintptr_t>(memory);
+                    uintptr_t aligned = roundUp(start, kHugePageSize);
+                    if (aligned != start) {
+                        munmap(memory, aligned - start);
+                    }
+                    if (aligned + bytes != start + bytes + slack) {
+                        munmap(reinterpret_cast<void*>(aligned + bytes), start + slack - aligned);
+                    }
+                    memory = reinterpret_cast<void*>(aligned);
+#if defined(MADV_HUGEPAGE)
+                    madvise(memory, bytes, MADV_HUGEPAGE);
+#endif
+                }
+            }
+#if defined(SYS_mbind)
+            int node = options.numaNode == PageOptions::kLocalNode ? currentNode() : options.numaNode;
+            if (node >= 0 && node < 64) {
+                constexpr int kMpolPreferred = 1;
+                unsigned long nodeMask = 1UL << node;
+                syscall(SYS_mbind, memory, bytes, kMpolPreferred, &nodeMask, sizeof(nodeMask) * 8, 0); // A failed bind only costs locality
+            }
+#endif
+            return memory;
+#else
+            (void)bytes;
+            (void)options;
+            return nullptr;
+#endif
+        }
+
+        inline void unmap(void* memory, size_t bytes) {
+#if defined(__linux__)
+            munmap(memory, bytes);
+#else
+            (void)memory;
+            (void)bytes;
+#endif
+        }
+    }
+}
+
+#endif // PAGE_ALLOCATOR_HPP
@@ -0,0 +1,264 @@
+#ifndef SLAB_ALLOCATOR_HPP
+#define SLAB_ALLOCATOR_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+#include "utility/page_allocator.hpp"
+/*
+ * A size class allocator for small objects that come and go at a high rate, such as the
+ * nodes of a cache. Sizes are rounded up to a multiple of kGranularity; every class has a
+ * free list per thread, so allocate and deallocate are a pop and a push with no lock. A
+ * thread takes objects from the central pool kBatch at a time, the central pool cuts them
+ * from kSlabBytes slabs, and a thread gives kBatch back whenever it holds 2 * kBatch of a
+ * class, and everything when it exits; objects freed on a thread after its cache is gone go
+ * straight to the central pool. Slabs are kept for the life of the process.
+ * Objects larger than kMaxSize go to operator new. After SlabAllocator::setPageOptions new
+ * slabs are cut from mapped regions, a huge page each with huge pages, with a region per
+ * NUMA node for PageOptions::kLocalNode.
+ */
+namespace OrangeKV {
+    namespace slab {
+        constexpr size_t kGranularity = 16;
+        constexpr size_t kMaxSize = 1024;
+        constexpr size_t kClasses = kMaxSize / kGranularity;
+        constexpr size_t kSlabBytes = 64 * 1024;
+        constexpr size_t kBatch = 64;
+
+        struct FreeObject {
+            FreeObject* next;
+        };
+
+        inline size_t classOf(size_t bytes) {
+            return bytes == 0 ? 0 : (bytes - 1) / kGranularity;
+        }
+        inline size_t classSize(size_t sizeClass) {
+            return (sizeClass + 1) * kGranularity;
+        }
+
+        // The objects every thread cache takes from and gives back to
+        class CentralPool {
+        private:
+            struct Batch {
+                FreeObject* head;
+                size_t count;
+            };
+            std::mutex mutex;
+            std::vector<Batch> batches[kClasses];
+            char* slabPtr[kClasses] = {}; // The uncut part of the slab of each class
+            size_t slabRemaining[kClasses] = {};
+            std::vector<char*> slabs;
+            struct Region {
+                char* next = nullptr;
+                size_t remaining = 0;
+            };
+            PageOptions pageOptions;
+            std::map<int, Region> regions; // The mapped region slabs are cut from, by node
+
+            char* newSlab() {
+                if (pageOptions.enabled()) {
+                    int node = pageOptions.numaNode == PageOptions::kLocalNode ? pages::currentNode() : pageOptions.numaNode;
+                    Region& region = regions[node];
+                    if (region.remaining < kSlabBytes) {
+                        PageOptions options = pageOptions;
+                        options.numaNode = node;
+                        size_t bytes = pages::mappedSize(pageOptions.hugePages != HugePages::kNone ? pages::kHugePageSize : kSlabBytes, options);
+                        auto* memory = static_cast<char*>(pages::map(bytes, options));
+                        if (memory != nullptr) { // Mapped regions stay for the life of the process, like the slabs
+                            region = Region{memory, bytes};
+                        }
+                    }
+                    if (region.remaining >= kSlabBytes) {
+                        char* slab = region.next;
+                        region.next += kSlabBytes;
+                        region.remaining -= kSlabBytes;
+                        return slab;
+                    }
+                }
+                char* slab = new char[kSlabBytes];
+                slabs.push_back(slab);
+                return slab;
+            }
+        public:
+            void setPageOptions(const PageOptions& options) {
+                std::lock_guard<std::mutex> lock(mutex);
+                pageOptions = options;
+            }
+
+            // Take up to kBatch objects of a class, the count taken is returned in count
+            FreeObject* fetch(size_t sizeClass, size_t& count) {
+                std::lock_guard<std::mutex> lock(mutex);
+                std::vector<Batch>& list = batches[sizeClass];
+                if (!list.empty()) {
+                    Batch batch = list.back();
+                    list.pop_back();
+                    count = batch.count;
+                    return batch.head;
+                }
+                size_t size = classSize(sizeClass);
+                if (slabRemaining[sizeClass] < size) {
+                    slabPtr[sizeClass] = newSlab();
+                    slabRemaining[sizeClass] = kSlabBytes;
+                }
+                FreeObject* head = nullptr;
+                count = 0;
+                while (count < kBatch && slabRemaining[sizeClass] >= size) {
+                    auto* object = reinterpret_cast<FreeObject*>(slabPtr[sizeClass]);
+                    object->next = head;
+                    head = object;
+                    slabPtr[sizeClass] += size;
+                    slabRemaining[sizeClass] -= size;
+                    count++;
+                }
+                return head;
+            }
+            void release(size_t sizeClass, FreeObject* head, size_t count) {
+                std::lock_guard<std::mutex> lock(mutex);
+                batches[sizeClass].push_back(Batch{head, count});
+            }
+
+            // One object at a time, for a thread whose cache is already destroyed
+            void* fetchOne(size_t sizeClass) {
+                size_t count;
+                FreeObject* head = fetch(sizeClass, count);
+                if (count > 1) {
+                    release(sizeClass, head->next, count - 1);
+                }
+                return head;
+            }
+            void releaseOne(size_t sizeClass, void* pointer) {
+                auto* object = static_cast<FreeObject*>(pointer);
+                object->next = nullptr;
+                release(sizeClass, object, 1);
+            }
+        };
+
+        // Leaked on purpose, thread caches give their objects back to it as late as thread exit
+        inline CentralPool& centralPool() {
+            static CentralPool* pool = new CentralPool;
+            return *pool;
+        }
+
+        // Set when the cache of the thread is destroyed. Objects with static storage duration,
+        // such as a global cache, are destroyed after the thread locals of the main thread and
+        // free their nodes then; a bool has no destructor, so it can still be read
+        inline thread_local bool threadCacheDestroyed = false;
+
+        class ThreadCache {
+        private:
+            FreeObject* lists[kClasses] = {};
+            size_t counts[kClasses] = {};
+        public:
+            ThreadCache() = default;
+            ThreadCache(const ThreadCache&) = delete;
+            ThreadCache& operator=(const ThreadCache&) = delete;
+            ~ThreadCache() {
+                threadCacheDestroyed = true;
+                for (size_t sizeClass = 0; sizeClass < kClasses; sizeClass++) {
+                    if (lists[sizeClass] != nullptr) {
+                        centralPool().release(sizeClass, lists[sizeClass], counts[sizeClass]);
+                    }
+                }
+            }
+            void* allocate(size_t sizeClass) {
+                FreeObject* object = lists[sizeClass];
+                if (object == nullptr) {
+                    object = centralPool().fetch(sizeClass, counts[sizeClass]);
+                }
+                lists[sizeClass] = object->next;
+                counts[sizeClass]--;
+                return object;
+            }
+            void deallocate(size_t sizeClass, void* pointer) {
+                auto* object = static_cast<FreeObject*>(pointer);
+                object->next = lists[sizeClass];
+                lists[sizeClass] = object;
+                if (++counts[sizeClass] >= 2 * kBatch) { // Give the older half back
+                    FreeObject* last = object;
+                    for (size_t i = 1; i < kBatch; i++) {
+                        last = last->next;
+                    }
+                    FreeObject* rest = last->next;
+                    last->next = nullptr;
+                    centralPool().release(sizeClass, rest, counts[sizeClass] - kBatch);
+                    counts[sizeClass] = kBatch;
+                }
+            }
+        };
+
+        inline ThreadCache& threadCache() {
+            thread_local ThreadCache cache;
+            return cache;
+        }
+    }
+
+    // The slab allocator, bytes must be the same in allocate and deallocate
+    struct SlabAllocator {
+        static void* allocate(size_t bytes) {
+            if (bytes > slab::kMaxSize) {
+                return ::operator new(bytes);
+            }
+            if (slab::threadCacheDestroyed) {
+                return slab::centralPool().fetchOne(slab::classOf(bytes));
+            }
+            return slab::threadCache().allocate(slab::classOf(bytes));
+        }
+        static void deallocate(void* pointer, size_t bytes) {
+            if (bytes > slab::kMaxSize) {
+                ::operator delete(pointer);
+                return;
+            }
+            if (slab::threadCacheDestroyed) {
+                slab::centralPool().releaseOne(slab::classOf(bytes), pointer);
+                return;
+            }
+            slab::threadCache().deallocate(slab::classOf(bytes), pointer);
+        }
+        // The bytes an allocation of bytes takes
+        static size_t allocatedBytes(size_t bytes) {
+            return bytes > slab::kMaxSize ? bytes : slab::classSize(slab::classOf(bytes));
+        }
+        // Back the slabs cut from now on with mapped pages
+        static void setPageOptions(const PageOptions& options) {
+            slab::centralPool().setPageOptions(options);
+        }
+    };
+
+    // A standard allocator over SlabAllocator, for the nodes of standard containers
+    template<typename T>
+    class SlabStdAllocator {
+    public:
+        using value_type = T;
+
+        SlabStdAllocator() noexcept = default;
+        template<typename U>
+        SlabStdAllocator(const SlabStdAllocator<U>&) noexcept {}
+
+        T* allocate(size_t n) {
+            if constexpr (alignof(T) > slab::kGranularity) {
+                return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(alignof(T))));
+            }
+            else {
+                return static_cast<T*>(SlabAllocator::allocate(n * sizeof(T)));
+            }
+        }
+        void deallocate(T* pointer, size_t n) noexcept {
+            if constexpr (alignof(T) > slab::kGranularity) {
+                ::operator delete(pointer, std::align_val_t(alignof(T)));
+            }
+            else {
+                SlabAllocator::deallocate(pointer, n * sizeof(T));
+            }
+        }
+        template<typename U>
+        bool operator==(const SlabStdAllocator<U>&) const noexcept {
+            return true;
+        }
+    };
+}
+
+#endif // SLAB_ALLOCATOR_HPP
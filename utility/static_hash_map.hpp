@@ -0,0 +1,122 @@
+#ifndef STATIC_HASH_MAP_HPP
+#define STATIC_HASH_MAP_HPP
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <bit>
+#include <string_view>
+#include <utility>
+#include "utility/hash.hpp"
+/*
+ * A read only map from a fixed set of string keys, built at compile time with a perfect hash:
+ * every key has a slot of its own, so a lookUp is one WyHash64 of the key, two array reads and
+ * one key comparison. This is for tables that are known when the program is written, such as
+ * command names or metric names.
+ */
+namespace OrangeKV {
+    /**
+     * The keys are split into buckets by their hash, and every bucket gets the seed that moves
+     * its keys into free slots (hash and displace). Buckets are placed from the largest down,
+     * while there is still room, so a seed is found after a few tries.
+     */
+    template<typename ValueType, size_t N>
+    class StaticHashMap {
+    public:
+        using Entry = std::pair<std::string_view, ValueType>;
+        static constexpr size_t kSlots = std::bit_ceil(N + N / 4 + 1);
+        static constexpr size_t kBuckets = N / 2 + 1;
+    private:
+        std::array<std::string_view, kSlots> keys{};
+        std::array<ValueType, kSlots> values{};
+        std::array<bool, kSlots> used{};
+        std::array<uint32_t, kBuckets> seeds{}; // The displacement seed of each bucket
+
+        static constexpr uint64_t slotHash(uint64_t hash, uint32_t seed) {
+            return wy::mix(hash ^ wy::kSecret[0], seed ^ wy::kSecret[1]);
+        }
+        static constexpr size_t bucketOf(uint64_t hash) {
+            return static_cast<size_t>((hash >> 32) % kBuckets);
+        }
+    public:
+        // Duplicate keys are a compile error
+        constexpr explicit StaticHashMap(const Entry (&entries)[N]) {
+            std::array<uint64_t, N> hashes{};
+            std::array<size_t, kBuckets> bucketSize{};
+            for (size_t i = 0; i < N; i++) {
+                hashes[i] = WyHash64(entries[i].first);
+                bucketSize[bucketOf(hashes[i])]++;
+            }
+            std::array<size_t, kBuckets> order{};
+            for (size_t b = 0; b < kBuckets; b++) {
+                order[b] = b;
+            }
+            for (size_t i = 1; i < kBuckets; i++) { // Insertion sort, largest bucket first
+                for (size_t j = i; j > 0 && bucketSize[order[j - 1]] < bucketSize[order[j]]; j--) {
+                    std::swap(order[j - 1], order[j]);
+                }
+            }
+            std::array<size_t, N> members{};
+            for (size_t b : order) {
+                if (bucketSize[b] == 0) {
+                    break;
+                }
+                size_t count = 0;
+                for (size_t i = 0; i < N; i++) {
+                    if (bucketOf(hashes[i]) == b) {
+                        members[count++] = i;
+                    }
+                }
+                for (uint32_t seed = 0;; seed++) {
+                    bool fits = true;
+                    for (size_t m = 0; m < count && fits; m++) {
+                        size_t slot = slotHash(hashes[members[m]], seed) & (kSlots - 1);
+                        fits = !used[slot];
+                        for (size_t other = 0; other < m && fits; other++) {
+                            if (entries[members[m]].first == entries[members[other]].first) {
+                                throw "StaticHashMap: duplicate key";
+                            }
+                            fits = slot != (slotHash(hashes[members[other]], seed) & (kSlots - 1));
+                        }
+                    }
+                    if (fits) {
+                        for (size_t m = 0; m < count; m++) {
+                            size_t slot = slotHash(hashes[members[m]], seed) & (kSlots - 1);
+                            used[slot] = true;
+                            keys[slot] = entries[members[m]].first;
+                            values[slot] = entries[members[m]].second;
+                        }
+                        seeds[b] = seed;
+                        break;
+                    }
+                }
+            }
+        }
+
+        // Get the value of a key, nullptr if the key is not in the map
+        constexpr const ValueType* find(std::string_view key) const {
+            uint64_t hash = WyHash64(key);
+            size_t slot = slotHash(hash, seeds[bucketOf(hash)]) & (kSlots - 1);
+            return used[slot] && keys[slot] == key ? &values[slot] : nullptr;
+        }
+        constexpr bool contains(std::string_view key) const {
+            return find(key) != nullptr;
+        }
+        constexpr size_t size() const {
+            return N;
+        }
+    };
+
+    /**
+     * @brief Builds a StaticHashMap, usually as a constexpr variable.
+     *
+     * constexpr auto kCommands = MakeStaticHashMap<int>({{"get", 1}, {"set", 2}});
+     *
+     * @param entries The keys and their values, the keys must be distinct.
+     * @return The map.
+     */
+    template<typename ValueType, size_t N>
+    constexpr StaticHashMap<ValueType, N> MakeStaticHashMap(const std::pair<std::string_view, ValueType> (&entries)[N]) {
+        return StaticHashMap<ValueType, N>(entries);
+    }
+}
+#endif // STATIC_HASH_MAP_HPP